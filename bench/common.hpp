@@ -0,0 +1,127 @@
+#pragma once
+
+// Helpers shared by the benchmarks: generated meshes, argument parsing, timing and JSON output.
+
+#include <objreader.hpp>
+#include <timing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+/** Vertices per side of a grid with about `targetTriangles` triangles.*/
+inline long gridSide(const long targetTriangles) {
+    return std::max(2L, long(std::ceil(std::sqrt(double(targetTriangles) / 2))) + 1);
+}
+
+/** Grid of `side`x`side` vertices at `surface(u, v)` for u, v in [0, 1], two triangles per quad. Replaces the mesh's vertices and triangles; normals are left to the caller.*/
+template <typename Surface>
+void makeGrid(ObjData &obj, const long side, Surface surface) {
+    obj.vertices.clear();
+    obj.elements3.clear();
+    obj.vertices.reserve(size_t(side * side));
+    obj.elements3.reserve(size_t(2 * (side - 1) * (side - 1)));
+    for (long y = 0; y < side; y++)
+        for (long x = 0; x < side; x++) obj.vertices.push_back(surface(x / float(side - 1), y / float(side - 1)));
+    for (long y = 0; y + 1 < side; y++)
+        for (long x = 0; x + 1 < side; x++) {
+            GLuint a = GLuint(y * side + x), b = a + 1, c = b + GLuint(side), d = a + GLuint(side);
+            obj.elements3.push_back({a, b, c});
+            obj.elements3.push_back({a, c, d});
+        }
+    obj.nVertices = GLuint(obj.vertices.size());
+    obj.nElements3 = GLuint(obj.elements3.size());
+    obj.isOk = true;
+}
+
+/** A command line option: `--name value`, or `--name` alone when `set` is called with nullptr.*/
+struct Flag {
+    std::string name;
+    std::string example;
+    std::function<void(const char *value)> set;
+    bool takesValue = true;
+};
+
+inline Flag intFlag(const std::string &name, int &value, const int minimum) {
+    return {name, std::to_string(value), [&value, minimum](const char *v) { value = std::max(minimum, std::atoi(v)); }};
+}
+
+inline Flag sizeFlag(const std::string &name, size_t &value) {
+    return {name, std::to_string(value), [&value](const char *v) { value = size_t(std::max(0, std::atoi(v))); }};
+}
+
+/** Comma separated list, e.g. `--sizes 1000,10000`.*/
+inline Flag listFlag(const std::string &name, std::vector<long> &values) {
+    std::string example;
+    for (long v : values) example += (example.empty() ? "" : ",") + std::to_string(v);
+    return {name, example, [&values](const char *v) {
+        values.clear();
+        std::stringstream list(v);
+        std::string item;
+        while (std::getline(list, item, ',')) values.push_back(std::atol(item.c_str()));
+    }};
+}
+
+inline Flag switchFlag(const std::string &name, bool &value) {
+    return {name, "", [&value](const char *) { value = true; }, false};
+}
+
+/** Apply `flags` to the arguments. Prints the usage and returns false on an unknown or incomplete one.*/
+inline bool parseArgs(int argc, char **argv, const std::vector<Flag> &flags) {
+    for (int i = 1; i < argc; i++) {
+        const Flag *flag = nullptr;
+        for (auto &f : flags)
+            if (argv[i] == "--" + f.name) flag = &f;
+        if (flag != nullptr && !flag->takesValue) flag->set(nullptr);
+        else if (flag != nullptr && i + 1 < argc) flag->set(argv[++i]);
+        else {
+            std::string usage = "usage: " + std::string(argv[0]);
+            for (auto &f : flags) usage += " [--" + f.name + (f.takesValue ? " " + f.example : "") + "]";
+            std::fprintf(stderr, "%s\n", usage.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Fastest of `repeat` runs of `body`, in milliseconds. `setup` runs untimed before each.*/
+template <typename Setup, typename Body>
+double fastest(const int repeat, Setup setup, Body body) {
+    double best = 1e300;
+    for (int i = 0; i < std::max(1, repeat); i++) {
+        setup();
+        auto start = timing::Clock::now();
+        body();
+        best = std::min(best, timing::milliseconds(timing::Clock::now() - start));
+    }
+    return best;
+}
+
+/** `fastest` with the GPU finished before and after each run, so the time includes the GL work `body` submits.*/
+template <typename Setup, typename Body>
+double fastestGL(const int repeat, Setup setup, Body body) {
+    return fastest(repeat, [&] { setup(); glFinish(); }, [&] { body(); glFinish(); });
+}
+
+inline FrameStats summarize(const std::vector<double> &times) {
+    FrameTimeHistory history(std::max<size_t>(1, times.size()));
+    for (double t : times) history.push(t);
+    return history.stats();
+}
+
+/** `{"count": ..., "mean": ..., "min": ..., "p50": ..., "p90": ..., "p99": ..., "max": ...}`*/
+inline std::string statsJSON(const FrameStats &s) {
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), "{\"count\": %d, \"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+                  s.count, s.mean, s.min, s.p50, s.p90, s.p99, s.max);
+    return buf;
+}
+
+}
@@ -0,0 +1,126 @@
+// CPU vs compute-shader mesh processing benchmark and check.
+//
+// Builds wavy grid meshes on a headless EGL context, then runs smooth normals, bounds and
+// recentering on the CPU(plus the upload the CPU path needs) and with MeshCompute, and checks
+// the GPU results against the CPU ones. Results are printed as JSON; the exit code is 1 if a
+// check fails.
+//
+//   compute_bench [--vertices 10000,100000,1000000] [--repeat 5]
+
+#define YGL_HEADLESS_EGL
+#include <YGLWindow.hpp>
+#include <meshcompute.hpp>
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::vector<long> vertices = {10000, 100000, 1000000};
+    int repeat = 5;
+};
+
+/** Grid of about `targetVertices` vertices, offset from the origin so recentering moves it.*/
+void makeGrid(ObjData &obj, const long targetVertices) {
+    bench::makeGrid(obj, std::max(2L, long(std::ceil(std::sqrt(double(targetVertices))))), [](float u, float v) {
+        return glm::vec3(u * 4 + 3, v * 4 - 7, 0.3f * std::sin(u * 25) * std::cos(v * 19) + 2);
+    });
+    obj.syncedNormals.assign(obj.nVertices, glm::vec3(0));
+    obj.nSyncedNormals = obj.nVertices;
+}
+
+void upload(const GLName &buffer, const std::vector<glm::vec3> &data) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, GLsizeiptr(data.size() * sizeof(glm::vec3)), data.data());
+}
+
+float maxDifference(const std::vector<glm::vec3> &a, const std::vector<glm::vec3> &b) {
+    float d = 0;
+    for (size_t i = 0; i < std::min(a.size(), b.size()); i++) {
+        glm::vec3 e = glm::abs(a[i] - b[i]);
+        d = std::max(d, std::max(e.x, std::max(e.y, e.z)));
+    }
+    return a.size() == b.size() ? d : INFINITY;
+}
+
+std::string runCase(MeshCompute &compute, const Options &opt, const long targetVertices, bool &ok) {
+    ObjData obj;
+    makeGrid(obj, targetVertices);
+    obj.generateBuffers();
+    const std::vector<glm::vec3> original = obj.vertices;
+    auto restore = [&] {
+        obj.vertices = original;
+        upload(obj.vertexBuffer, obj.vertices);
+    };
+
+    // CPU path: compute, then upload what changed.
+    double cpuNormals = bench::fastestGL(opt.repeat, [] {}, [&] {
+        obj.computeSmoothNormals();
+        upload(obj.syncedNormalBuffer, obj.syncedNormals);
+    });
+    const std::vector<glm::vec3> cpuNormalData = obj.syncedNormals;
+    double cpuBounds = bench::fastestGL(opt.repeat, [] {}, [&] { obj.computeBounds(); });
+    const glm::vec3 cpuMin = obj.minPos, cpuMax = obj.maxPos;
+    double cpuCenter = bench::fastestGL(opt.repeat, restore, [&] {
+        obj.computeBounds();
+        obj.adjustCenter();
+        upload(obj.vertexBuffer, obj.vertices);
+    });
+    const std::vector<glm::vec3> cpuCentered = obj.vertices;
+
+    // GPU path on the same buffers.
+    restore();
+    double gpuNormals = bench::fastestGL(opt.repeat, [] {}, [&] { compute.smoothNormals(obj); });
+    double gpuBounds = bench::fastestGL(opt.repeat, [] {}, [&] { compute.bounds(obj); });
+    const glm::vec3 gpuMin = obj.minPos, gpuMax = obj.maxPos;
+    double gpuCenter = bench::fastestGL(opt.repeat, restore, [&] { compute.recenter(obj); });
+
+    compute.download(obj);
+    float normalError = maxDifference(obj.syncedNormals, cpuNormalData);
+    float centerError = maxDifference(obj.vertices, cpuCentered);
+    bool boundsEqual = gpuMin == cpuMin && gpuMax == cpuMax;
+    // Fixed point sums round each triangle's normal to 2^-16.
+    bool pass = boundsEqual && normalError < 1e-3f && centerError == 0;
+    ok = ok && pass;
+
+    char buf[1024];
+    std::snprintf(buf, sizeof(buf),
+                  "    {\"vertices\": %u, \"triangles\": %u,\n"
+                  "     \"cpu_ms\": {\"normals\": %.3f, \"bounds\": %.3f, \"recenter\": %.3f},\n"
+                  "     \"gpu_ms\": {\"normals\": %.3f, \"bounds\": %.3f, \"recenter\": %.3f},\n"
+                  "     \"check\": {\"max_normal_error\": %.3g, \"bounds_equal\": %s, \"max_recenter_error\": %.3g, \"pass\": %s}}",
+                  obj.nVertices, obj.nElements3, cpuNormals, cpuBounds, cpuCenter, gpuNormals, gpuBounds, gpuCenter,
+                  double(normalError), boundsEqual ? "true" : "false", double(centerError), pass ? "true" : "false");
+    return buf;
+}
+
+}
+
+int main(int argc, char **argv) {
+    Options opt;
+    if (!bench::parseArgs(argc, argv, {bench::listFlag("vertices", opt.vertices), bench::intFlag("repeat", opt.repeat, 1)}))
+        return 2;
+    // YGL logs progress on std::cout; keep stdout for the JSON.
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+    YGLWindow window(64, 64, "compute_bench", true);
+    if (!window.isOk()) {
+        std::fprintf(stderr, "No headless context\n");
+        return 1;
+    }
+    MeshCompute compute;
+    if (!compute.init()) return 1;
+
+    bool ok = true;
+    std::printf("{\n  \"benchmark\": \"mesh_compute\",\n");
+    std::printf("  \"renderer\": \"%s\",\n  \"cases\": [\n", reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+    for (size_t i = 0; i < opt.vertices.size(); i++)
+        std::printf("%s%s", runCase(compute, opt, opt.vertices[i], ok).c_str(), i + 1 < opt.vertices.size() ? ",\n" : "\n");
+    std::printf("  ]\n}\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,277 @@
+// CPU-side mesh pipeline benchmark.
+//
+// Generates grid meshes in OBJ form, then times the ObjData stages on them.
+// Each size runs in its own process, so peak RSS belongs to that size alone.
+// Results are printed as JSON.
+//
+//   mesh_bench [--sizes 1000,10000,...] [--dir /tmp] [--repeat 3] [--materials 256] [--threads 0] [--keep]
+//
+// --threads sets the ThreadPool size for the post-load stages(0: one per hardware thread, 1: serial).
+
+#include <objreader.hpp>
+
+#include "common.hpp"
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Every allocation in the process goes through these, so a stage's allocation count is the counter difference.
+static std::atomic<unsigned long long> allocCount{0};
+static std::atomic<unsigned long long> allocBytes{0};
+
+void *operator new(size_t size) {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    allocBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+struct Options {
+    std::vector<long> sizes = {1000, 10000, 100000, 1000000, 10000000};
+    std::string dir = "/tmp";
+    int repeat = 3;
+    int materials = 256;
+    int threads = 0;
+    bool keep = false;
+};
+
+struct StageResult {
+    std::string name;
+    double ms = 0;
+    double itemsPerSecond = 0;
+    const char *items = "";
+    double mbPerSecond = 0;
+    unsigned long long allocations = 0;
+    unsigned long long allocatedBytes = 0;
+};
+
+struct Mesh {
+    std::string objName, mtlName;
+    long triangles = 0;
+    long vertices = 0;
+    long fileBytes = 0;
+    long mtlBytes = 0;
+};
+
+/** Grid of `n`x`n` quads on a wavy surface, with per-vertex normals and `f v//vn` faces.*/
+Mesh writeMesh(const Options &opt, const long targetTriangles) {
+    Mesh mesh;
+    std::string base = "mesh_bench_" + std::to_string(getpid()) + "_" + std::to_string(targetTriangles);
+    mesh.objName = base + ".obj";
+    mesh.mtlName = base + ".mtl";
+
+    FILE *mtl = std::fopen((opt.dir + "/" + mesh.mtlName).c_str(), "w");
+    for (int i = 0; i < opt.materials; i++)
+        std::fprintf(mtl, "newmtl m%d\nKa 0.1 0.1 0.1\nKd %.3f 0.5 0.5\nKs 1 1 1\n\n", i, i / float(opt.materials));
+    std::fclose(mtl);
+
+    struct stat st;
+    if (stat((opt.dir + "/" + mesh.mtlName).c_str(), &st) == 0) mesh.mtlBytes = st.st_size;
+
+    long n = std::max(1L, long(std::ceil(std::sqrt(targetTriangles / 2.0))));
+    long side = n + 1;
+    mesh.triangles = 2 * n * n;
+    mesh.vertices = side * side;
+
+    std::string path = opt.dir + "/" + mesh.objName;
+    FILE *obj = std::fopen(path.c_str(), "w");
+    std::fprintf(obj, "mtllib %s\no grid\n", mesh.mtlName.c_str());
+    for (long y = 0; y < side; y++)
+        for (long x = 0; x < side; x++) {
+            float u = x / float(n) * 20, v = y / float(n) * 20;
+            std::fprintf(obj, "v %.6f %.6f %.6f\n", u, v, 0.5f * std::sin(u) * std::cos(v));
+        }
+    for (long y = 0; y < side; y++)
+        for (long x = 0; x < side; x++) {
+            float u = x / float(n) * 20, v = y / float(n) * 20;
+            glm::vec3 normal = glm::normalize(glm::vec3(-0.5f * std::cos(u) * std::cos(v), 0.5f * std::sin(u) * std::sin(v), 1));
+            std::fprintf(obj, "vn %.6f %.6f %.6f\n", normal.x, normal.y, normal.z);
+        }
+    std::fprintf(obj, "usemtl m0\n");
+    for (long y = 0; y < n; y++)
+        for (long x = 0; x < n; x++) {
+            long a = y * side + x + 1, b = a + 1, c = b + side, d = a + side;
+            std::fprintf(obj, "f %ld//%ld %ld//%ld %ld//%ld %ld//%ld\n", a, a, b, b, c, c, d, d);
+        }
+    std::fclose(obj);
+
+    if (stat(path.c_str(), &st) == 0) mesh.fileBytes = st.st_size;
+    return mesh;
+}
+
+/** Run `body` `repeat` times and keep the fastest run. `setup` runs untimed before each.*/
+template <typename Setup, typename Body>
+StageResult measure(const char *name, const int repeat, Setup setup, Body body) {
+    StageResult result;
+    result.name = name;
+    result.ms = 1e300;
+    for (int i = 0; i < std::max(1, repeat); i++) {
+        setup();
+        unsigned long long count0 = allocCount.load(), bytes0 = allocBytes.load();
+        auto start = timing::Clock::now();
+        body();
+        double ms = timing::milliseconds(timing::Clock::now() - start);
+        if (ms < result.ms) {
+            result.ms = ms;
+            result.allocations = allocCount.load() - count0;
+            result.allocatedBytes = allocBytes.load() - bytes0;
+        }
+    }
+    return result;
+}
+
+void rate(StageResult &r, const double items, const char *unit, const double bytes = 0) {
+    double seconds = std::max(r.ms, 1e-6) / 1000;
+    r.itemsPerSecond = items / seconds;
+    r.items = unit;
+    r.mbPerSecond = bytes / seconds / (1024.0 * 1024.0);
+}
+
+std::string runCase(const Options &opt, const long targetTriangles) {
+    Mesh mesh = writeMesh(opt, targetTriangles);
+    // Pool threads are started here, in the child; they would not survive the fork.
+    ThreadPool::get().resize(size_t(opt.threads));
+
+    // The loader reports progress on std::cout. Keep it out of the timings and the JSON.
+    std::ostringstream sink;
+    std::streambuf *coutBuf = std::cout.rdbuf(sink.rdbuf());
+
+    std::vector<StageResult> stages;
+    ObjData obj;
+    obj.prefix = opt.dir + "/";
+
+    StageResult mtl = measure("loadMtl", opt.repeat, [&] { obj.materialData.clear(); sink.str(""); },
+                              [&] { obj.loadMtl(mesh.mtlName); });
+    rate(mtl, opt.materials, "materials", mesh.mtlBytes);
+    stages.push_back(mtl);
+
+    StageResult load = measure("loadObject", 1, [&] { obj = ObjData(); obj.prefix = opt.dir + "/"; sink.str(""); },
+                               [&] { obj.loadObject(mesh.objName); });
+    rate(load, mesh.triangles, "triangles", mesh.fileBytes);
+    stages.push_back(load);
+    std::cout.rdbuf(coutBuf);
+
+    if (!opt.keep) {
+        std::remove((opt.dir + "/" + mesh.objName).c_str());
+        std::remove((opt.dir + "/" + mesh.mtlName).c_str());
+    }
+
+    if (!obj.isOk || long(obj.nElements3) != mesh.triangles) {
+        std::fprintf(stderr, "loadObject failed for %ld triangles\n", mesh.triangles);
+        return "";
+    }
+
+    // The grid uses the vertex index for the normal index as well.
+    std::vector<glm::uvec2> corners;
+    corners.reserve(obj.elements4.size() * 4);
+    for (auto &q : obj.elements4)
+        for (int i = 0; i < 4; i++) corners.push_back({q[i], q[i]});
+
+    StageResult normals = measure("computeSyncedNormals", opt.repeat, [] {}, [&] { obj.computeSyncedNormals(corners); });
+    rate(normals, corners.size(), "corners");
+    stages.push_back(normals);
+
+    StageResult bounds = measure("computeBounds", opt.repeat, [] {}, [&] { obj.computeBounds(); });
+    rate(bounds, obj.nVertices, "vertices");
+    stages.push_back(bounds);
+
+    // Recentering an already centered mesh moves nothing, so shift it back before each run.
+    glm::vec3 offset(1, 2, 3);
+    StageResult center = measure("adjustCenter", opt.repeat,
+                                 [&] { for (auto &v : obj.vertices) v += offset; obj.computeBounds(); },
+                                 [&] { obj.adjustCenter(); });
+    rate(center, obj.nVertices, "vertices");
+    stages.push_back(center);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    char buf[512];
+    std::string json;
+    std::snprintf(buf, sizeof(buf),
+                  "    {\"triangles\": %ld, \"vertices\": %ld, \"file_bytes\": %ld, \"peak_rss_kb\": %ld, \"threads\": %zu, \"stages\": [\n",
+                  mesh.triangles, mesh.vertices, mesh.fileBytes, long(usage.ru_maxrss), ThreadPool::get().size());
+    json += buf;
+    for (size_t i = 0; i < stages.size(); i++) {
+        const StageResult &r = stages[i];
+        std::snprintf(buf, sizeof(buf), "      {\"name\": \"%s\", \"ms\": %.3f, \"%s_per_s\": %.1f, ",
+                      r.name.c_str(), r.ms, r.items, r.itemsPerSecond);
+        json += buf;
+        // Only stages that read a file have a byte rate.
+        if (r.mbPerSecond > 0) {
+            std::snprintf(buf, sizeof(buf), "\"mb_per_s\": %.2f, ", r.mbPerSecond);
+            json += buf;
+        }
+        std::snprintf(buf, sizeof(buf), "\"allocations\": %llu, \"allocated_bytes\": %llu}%s\n",
+                      r.allocations, r.allocatedBytes, i + 1 < stages.size() ? "," : "");
+        json += buf;
+    }
+    json += "    ]}";
+    return json;
+}
+
+/** Run one case in a child process and return its JSON.*/
+std::string runIsolated(const Options &opt, const long triangles) {
+    int fds[2];
+    if (pipe(fds) != 0) return "";
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        std::string json = runCase(opt, triangles);
+        if (write(fds[1], json.data(), json.size()) < 0) _exit(1);
+        _exit(json.empty() ? 1 : 0);
+    }
+    close(fds[1]);
+    std::string json;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fds[0], buf, sizeof(buf))) > 0) json.append(buf, size_t(n));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? json : "";
+}
+
+}
+
+int main(int argc, char **argv) {
+    Options opt;
+    if (!bench::parseArgs(argc, argv, {bench::listFlag("sizes", opt.sizes), {"dir", opt.dir, [&](const char *v) { opt.dir = v; }},
+                                       bench::intFlag("repeat", opt.repeat, 1), bench::intFlag("materials", opt.materials, 1),
+                                       bench::intFlag("threads", opt.threads, 0), bench::switchFlag("keep", opt.keep)}))
+        return 2;
+
+    std::printf("{\"benchmark\": \"mesh\", \"cases\": [\n");
+    bool first = true, failed = false;
+    for (long triangles : opt.sizes) {
+        std::string json = runIsolated(opt, triangles);
+        if (json.empty()) {
+            failed = true;
+            continue;
+        }
+        std::printf("%s%s", first ? "" : ",\n", json.c_str());
+        std::fflush(stdout);
+        first = false;
+    }
+    std::printf("\n]}\n");
+    return failed ? 1 : 0;
+}
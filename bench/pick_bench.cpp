@@ -0,0 +1,125 @@
+// Ray picking benchmark and check.
+//
+// Builds a TriangleBVH over wavy grid meshes, places a few instances of each with model
+// matrices, and picks them with Camera::cursorRay from a grid of cursor positions. Every pick is
+// checked against testing all triangles. Results are printed as JSON; the exit code is 1 if a
+// pick differs.
+//
+//   pick_bench [--triangles 10000,100000,1000000] [--instances 4] [--rays 1024] [--threads 0]
+//
+// --threads sets the ThreadPool size for the build(0: one per hardware thread, 1: serial).
+
+#include <bvh.hpp>
+#include <camera.hpp>
+#include <timing.hpp>
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::vector<long> triangles = {10000, 100000, 1000000};
+    int instances = 4;
+    int rays = 1024;
+    size_t threads = 0;
+};
+
+/** Grid of about `targetTriangles` triangles over [-1, 1]^2, with waves so boxes overlap in depth.*/
+void makeGrid(ObjData &obj, const long targetTriangles) {
+    bench::makeGrid(obj, bench::gridSide(targetTriangles), [](float u, float v) {
+        return glm::vec3(u * 2 - 1, v * 2 - 1, 0.2f * std::sin(u * 17) * std::cos(v * 13));
+    });
+}
+
+/** Closest hit over all objects by testing every triangle, the reference for `Picker::pick`.*/
+RayHit pickAll(const Picker &picker, const Ray &ray) {
+    RayHit hit;
+    for (size_t i = 0; i < picker.objects.size(); i++)
+        if (picker.objects[i].bvh->intersectAll(ray.transformed(picker.objects[i].inverseModel), hit)) hit.object = i;
+    return hit;
+}
+
+/** Same hit, allowing a different triangle where a ray passes through a shared edge.*/
+bool sameHit(const RayHit &a, const RayHit &b) {
+    if (a.isHit() != b.isHit()) return false;
+    if (!a.isHit()) return true;
+    if (a.object == b.object && a.triangle == b.triangle) return a.t == b.t && a.barycentric == b.barycentric;
+    return std::abs(a.t - b.t) <= 1e-5f * std::max(1.f, a.t);
+}
+
+std::string runCase(const Options &opt, const long targetTriangles, bool &ok) {
+    ObjData obj;
+    makeGrid(obj, targetTriangles);
+
+    TriangleBVH bvh;
+    auto start = timing::Clock::now();
+    bvh.build(obj);
+    double buildMs = timing::milliseconds(timing::Clock::now() - start);
+
+    // Instances side by side, turned and scaled differently so the ray transform matters.
+    Picker picker;
+    for (int i = 0; i < opt.instances; i++) {
+        float offset = (i - (opt.instances - 1) * 0.5f) * 1.5f;
+        picker.add(bvh, glm::translate(glm::vec3(offset, 0.3f * i, -0.5f * i)) *
+                        glm::rotate(0.4f * i, glm::vec3(0, 1, 0)) * glm::scale(glm::vec3(1 + 0.25f * i)));
+    }
+
+    Camera view;
+    view.setPosition(glm::vec3(0, 1, 2.5f + opt.instances));
+    const int width = 1280, height = 720;
+    const float zNear = 0.1f, zFar = 100.f;
+    const int columns = std::max(1, int(std::sqrt(double(opt.rays) * width / height)));
+    const int rows = std::max(1, opt.rays / columns);
+
+    std::vector<double> pickUs, allUs;
+    int hits = 0, mismatches = 0;
+    for (int r = 0; r < rows; r++)
+        for (int c = 0; c < columns; c++) {
+            Ray ray = view.cursorRay((c + 0.5) * width / columns, (r + 0.5) * height / rows, width, height, zNear, zFar);
+            auto t0 = timing::Clock::now();
+            RayHit hit = picker.pick(ray);
+            auto t1 = timing::Clock::now();
+            RayHit reference = pickAll(picker, ray);
+            auto t2 = timing::Clock::now();
+            pickUs.push_back(timing::milliseconds(t1 - t0) * 1000);
+            allUs.push_back(timing::milliseconds(t2 - t1) * 1000);
+            hits += hit.isHit();
+            mismatches += !sameHit(hit, reference);
+        }
+    ok = ok && mismatches == 0;
+
+    char buf[1024];
+    std::snprintf(buf, sizeof(buf),
+                  "    {\"triangles\": %u, \"instances\": %d, \"rays\": %d, \"hits\": %d,\n"
+                  "     \"build_ms\": %.3f, \"nodes\": %zu, \"bvh_bytes\": %zu,\n"
+                  "     \"pick_us\": %s,\n"
+                  "     \"brute_force_us\": %s,\n"
+                  "     \"check\": {\"mismatches\": %d, \"pass\": %s}}",
+                  obj.nElements3, opt.instances, rows * columns, hits, buildMs, bvh.nodes.size(), bvh.memoryBytes(),
+                  bench::statsJSON(bench::summarize(pickUs)).c_str(), bench::statsJSON(bench::summarize(allUs)).c_str(),
+                  mismatches, mismatches == 0 ? "true" : "false");
+    return buf;
+}
+
+}
+
+int main(int argc, char **argv) {
+    Options opt;
+    if (!bench::parseArgs(argc, argv, {bench::listFlag("triangles", opt.triangles), bench::intFlag("instances", opt.instances, 1),
+                                       bench::intFlag("rays", opt.rays, 1), bench::sizeFlag("threads", opt.threads)}))
+        return 2;
+    ThreadPool::get().resize(opt.threads);
+
+    bool ok = true;
+    std::printf("{\n  \"benchmark\": \"pick\",\n  \"threads\": %zu,\n  \"cases\": [\n", ThreadPool::get().size());
+    for (size_t i = 0; i < opt.triangles.size(); i++)
+        std::printf("%s%s", runCase(opt, opt.triangles[i], ok).c_str(), i + 1 < opt.triangles.size() ? ",\n" : "\n");
+    std::printf("  ]\n}\n");
+    return ok ? 0 : 1;
+}
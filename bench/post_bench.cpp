@@ -0,0 +1,154 @@
+// Post-processing chain benchmark and check.
+//
+// Renders a test image on a headless EGL context, then runs a PostChain of per-pixel stages
+// (optionally behind a blur that samples neighbors) fused into one pass and unfused, one pass
+// per stage. Prints JSON with the pass counts and frame times of both, and checks that they
+// produce the same image; the exit code is 1 if they do not.
+//
+//   post_bench [--size 1920x1080] [--stages 1,2,4,8] [--blur] [--repeat 5]
+
+#define YGL_HEADLESS_EGL
+#include <YGLWindow.hpp>
+#include <postprocess.hpp>
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    int width = 1920, height = 1080;
+    std::vector<long> stages = {1, 2, 4, 8};
+    bool blur = false;
+    int repeat = 5;
+};
+
+const char *sceneFS = R"(#version 410 core
+out vec4 fragColor;
+void main() {
+    vec2 p = gl_FragCoord.xy / 256.0;
+    fragColor = vec4(fract(p.x), fract(p.y), 0.5 + 0.5 * sin(p.x * 7.0 + p.y * 3.0), 1.0);
+}
+)";
+
+/** Per-pixel stage `k`, one of a few simple grading operations with its own uniform.*/
+PostStage gradingStage(const int k) {
+    const std::string name = "grade" + std::to_string(k);
+    const std::string amount = name + "Amount";
+    const char *bodies[] = {
+        "return vec4(color.rgb * AMOUNT, color.a);",                                   // exposure
+        "return vec4((color.rgb - 0.5) * AMOUNT + 0.5, color.a);",                     // contrast
+        "float l = dot(color.rgb, vec3(0.2126, 0.7152, 0.0722));\n"
+        "    return vec4(mix(vec3(l), color.rgb, AMOUNT), color.a);",                  // saturation
+        "vec2 d = uv - 0.5;\n"
+        "    return vec4(color.rgb * (1.0 - AMOUNT * dot(d, d)), color.a);",           // vignette
+    };
+    std::string body = bodies[k % 4];
+    for (size_t at; (at = body.find("AMOUNT")) != std::string::npos;) body.replace(at, 6, amount);
+    const float value = k % 4 == 3 ? 0.5f : 1.0f + 0.02f * float(k % 3 - 1);
+    return {name,
+            "uniform float " + amount + ";\nvec4 " + name + "(vec4 color, vec2 uv) {\n    " + body + "\n}\n",
+            [amount, value](Program &p) { p.setUniform(amount.c_str(), value); }};
+}
+
+PostStage blurStage() {
+    PostStage stage{"blur", R"(
+vec4 blur(sampler2D image, vec2 uv) {
+    vec2 texel = 1.0 / vec2(textureSize(image, 0));
+    vec4 sum = vec4(0.0);
+    for (int y = -1; y <= 1; y++)
+        for (int x = -1; x <= 1; x++)
+            sum += texture(image, uv + vec2(x, y) * texel);
+    return sum / 9.0;
+}
+)", nullptr};
+    stage.samplesNeighbors = true;
+    return stage;
+}
+
+int maxDifference(const std::vector<GLubyte> &a, const std::vector<GLubyte> &b) {
+    int d = 0;
+    for (size_t i = 0; i < std::min(a.size(), b.size()); i++) d = std::max(d, std::abs(int(a[i]) - int(b[i])));
+    return a.size() == b.size() ? d : 255;
+}
+
+std::string runCase(YGLWindow &window, Framebuffer &scene, Framebuffer &screen, const Options &opt, const long nStages,
+                    bool &ok) {
+    PostChain chain;
+    if (opt.blur) chain.add(blurStage());
+    for (int k = 0; k < nStages; k++) chain.add(gradingStage(k));
+
+    std::vector<GLubyte> fusedPixels, separatePixels;
+    chain.fuse = true;
+    const size_t fusedPasses = chain.passCount();
+    const double fusedMs = bench::fastestGL(opt.repeat, [] {}, [&] { chain.render(scene, screen); });
+    window.readPixels(fusedPixels);
+
+    chain.fuse = false;
+    const size_t separatePasses = chain.passCount();
+    const double separateMs = bench::fastestGL(opt.repeat, [] {}, [&] { chain.render(scene, screen); });
+    window.readPixels(separatePixels);
+
+    // Unfused passes round to the 16-bit float intermediates in between.
+    const int difference = maxDifference(fusedPixels, separatePixels);
+    const bool pass = difference <= 2;
+    ok = ok && pass;
+
+    char buf[512];
+    std::snprintf(buf, sizeof(buf),
+                  "    {\"stages\": %ld, \"blur\": %s,\n"
+                  "     \"fused\": {\"passes\": %zu, \"ms\": %.3f},\n"
+                  "     \"separate\": {\"passes\": %zu, \"ms\": %.3f},\n"
+                  "     \"check\": {\"max_difference\": %d, \"pass\": %s}}",
+                  nStages, opt.blur ? "true" : "false", fusedPasses, fusedMs, separatePasses, separateMs, difference,
+                  pass ? "true" : "false");
+    return buf;
+}
+
+}
+
+int main(int argc, char **argv) {
+    Options opt;
+    bench::Flag size{"size", "1920x1080", [&](const char *v) {
+        if (std::sscanf(v, "%dx%d", &opt.width, &opt.height) == 2) return;
+        std::fprintf(stderr, "--size takes WIDTHxHEIGHT, not %s\n", v);
+        opt.width = opt.height = 0;
+    }};
+    if (!bench::parseArgs(argc, argv, {size, bench::listFlag("stages", opt.stages), bench::switchFlag("blur", opt.blur),
+                                       bench::intFlag("repeat", opt.repeat, 1)}) ||
+        opt.width <= 0 || opt.height <= 0)
+        return 2;
+    // YGL logs progress on std::cout; keep stdout for the JSON.
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+    YGLWindow window(opt.width, opt.height, "post_bench", true);
+    if (!window.isOk()) {
+        std::fprintf(stderr, "No headless context\n");
+        return 1;
+    }
+
+    Framebuffer scene, screen;
+    scene.init(opt.width, opt.height);
+    scene.attachTexture2D(1, GL_RGBA16F);
+    screen.initDefault(opt.width, opt.height);
+
+    Program sceneProgram;
+    sceneProgram.loadShaderSource(Framebuffer::fullscreenVS, sceneFS);
+    sceneProgram.use();
+    scene.renderFullscreen();
+
+    bool ok = true;
+    std::printf("{\n  \"benchmark\": \"post\",\n");
+    std::printf("  \"renderer\": \"%s\",\n  \"size\": [%d, %d],\n  \"cases\": [\n",
+                reinterpret_cast<const char *>(glGetString(GL_RENDERER)), opt.width, opt.height);
+    for (size_t i = 0; i < opt.stages.size(); i++)
+        std::printf("%s%s", runCase(window, scene, screen, opt, opt.stages[i], ok).c_str(),
+                    i + 1 < opt.stages.size() ? ",\n" : "\n");
+    std::printf("  ]\n}\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+// Headless draw-path benchmark.
+//
+// Renders a synthetic scene through Program, ObjData::render and Framebuffer::render on an
+// EGL context(Mesa llvmpipe works, no GPU or display needed), and reports CPU submit time,
+// GPU time and YGL's GL call counts per frame as JSON.
+//
+//   render_bench [--objects 256] [--triangles 2000] [--passes 1] [--frames 200] [--warmup 20]
+//                [--width 640] [--height 360] [--prepass]
+
+#define YGL_GL_STATS
+#define YGL_HEADLESS_EGL
+#include <YGLWindow.hpp>
+#include <gputimer.hpp>
+#include <objreader.hpp>
+
+#include "common.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    int objects = 256;
+    int triangles = 2000;
+    int passes = 1;
+    int frames = 200;
+    int warmup = 20;
+    int width = 640;
+    int height = 360;
+    bool prepass = false;
+};
+
+const char *vertexShader = R"(#version 410 core
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+uniform mat4 model;
+uniform mat4 viewProj;
+out vec3 normal;
+void main() {
+    normal = mat3(model) * inNormal;
+    gl_Position = viewProj * model * vec4(inPosition, 1);
+}
+)";
+
+const char *fragmentShader = R"(#version 410 core
+in vec3 normal;
+uniform vec3 color;
+out vec4 outColor;
+void main() {
+    float lambert = max(dot(normalize(normal), normalize(vec3(0.3, 0.5, 1))), 0.0);
+    outColor = vec4(color * (0.2 + 0.8 * lambert), 1);
+}
+)";
+
+/** Bumpy grid in [-0.5, 0.5]^2 with about `triangles` triangles, uploaded with `generateBuffers`.*/
+void makeGrid(ObjData &obj, const int triangles, const float phase) {
+    const float s = 6.2831853f * 2;
+    bench::makeGrid(obj, bench::gridSide(triangles), [&](float u, float v) {
+        return glm::vec3(u - 0.5f, v - 0.5f, 0.05f * std::sin(s * u + phase) * std::cos(s * v));
+    });
+    obj.syncedNormals.clear();
+    for (auto &p : obj.vertices) {
+        float u = p.x + 0.5f, v = p.y + 0.5f;
+        obj.syncedNormals.push_back(glm::normalize(glm::vec3(-0.05f * s * std::cos(s * u + phase) * std::cos(s * v),
+                                                             0.05f * s * std::sin(s * u + phase) * std::sin(s * v), 1)));
+    }
+    obj.nSyncedNormals = GLuint(obj.syncedNormals.size());
+    obj.computeBounds();
+    obj.generateBuffers();
+}
+
+void printStats(const char *name, const std::vector<double> &times) {
+    std::printf("  \"%s\": %s,\n", name, bench::statsJSON(bench::summarize(times)).c_str());
+}
+
+}
+
+int main(int argc, char **argv) {
+    Options opt;
+    if (!bench::parseArgs(argc, argv, {bench::intFlag("objects", opt.objects, 1), bench::intFlag("triangles", opt.triangles, 2),
+                                       bench::intFlag("passes", opt.passes, 1), bench::intFlag("frames", opt.frames, 1),
+                                       bench::intFlag("warmup", opt.warmup, 0), bench::intFlag("width", opt.width, 1),
+                                       bench::intFlag("height", opt.height, 1), bench::switchFlag("prepass", opt.prepass)}))
+        return 2;
+    // YGL logs progress on std::cout; keep stdout for the JSON.
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+    YGLWindow window(opt.width, opt.height, "render_bench", true);
+    if (!window.isOk()) {
+        std::fprintf(stderr, "No headless context\n");
+        return 1;
+    }
+
+    Program program;
+    std::vector<ObjData> objects;
+    std::vector<glm::mat4> models;
+    std::vector<glm::vec3> colors;
+    std::vector<Framebuffer> passes(opt.passes);
+    GPUTimer timer;
+
+    std::vector<double> cpuMs, gpuMs;
+    GLStats calls;
+    bool callsVary = false;
+
+    window.initFunc([&]() {
+        program.loadShaderSource(vertexShader, fragmentShader);
+
+        // Objects tile the view; each has its own VAO and buffers, like separately loaded meshes.
+        objects.resize(opt.objects);
+        int columns = int(std::ceil(std::sqrt(double(opt.objects))));
+        float cell = 2.0f / columns;
+        for (int i = 0; i < opt.objects; i++) {
+            makeGrid(objects[i], opt.triangles, float(i));
+            glm::vec3 offset(-1 + cell * (i % columns + 0.5f), -1 + cell * (i / columns + 0.5f), 0);
+            glm::mat4 model(1);
+            model[0][0] = model[1][1] = model[2][2] = cell * 0.9f;
+            model[3] = glm::vec4(offset, 1);
+            models.push_back(model);
+            colors.push_back(glm::vec3((i * 37 % 255) / 255.f, (i * 91 % 255) / 255.f, 0.6f));
+        }
+
+        for (auto &fb : passes) {
+            fb.init(opt.width, opt.height);
+            fb.attachTexture2D(1, GL_RGBA8);
+            fb.attachRenderBuffer(GL_DEPTH24_STENCIL8);
+            fb.depthPrepass = opt.prepass;
+        }
+        timer.init();
+    });
+
+    window.renderFunc([&]() {
+        GLStats::get().reset();
+        auto start = timing::Clock::now();
+        timer.begin();
+
+        const glm::mat4 viewProj(1);
+        for (auto &fb : passes) {
+            fb.render(nullptr, [&](bool) {
+                program.use();
+                program.setUniform("viewProj", viewProj);
+                for (size_t i = 0; i < objects.size(); i++) {
+                    program.setUniform("model", models[i]);
+                    program.setUniform("color", colors[i]);
+                    objects[i].render();
+                }
+            });
+        }
+
+        timer.end();
+        double submit = timing::milliseconds(timing::Clock::now() - start);
+
+        std::vector<double> finished;
+        timer.poll(finished);
+        if (window.frameCount() >= opt.warmup) {
+            cpuMs.push_back(submit);
+            gpuMs.insert(gpuMs.end(), finished.begin(), finished.end());
+            const GLStats &frame = GLStats::get();
+            if (cpuMs.size() > 1 && frame.total() != calls.total()) callsVary = true;
+            calls = frame;
+        }
+    });
+
+    window.maxFrames(opt.warmup + opt.frames);
+    window.mainLoop();
+    timer.poll(gpuMs);
+
+    std::printf("{\n  \"benchmark\": \"render\",\n");
+    std::printf("  \"renderer\": \"%s\",\n", reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+    std::printf("  \"config\": {\"objects\": %d, \"triangles_per_object\": %u, \"passes\": %d, \"frames\": %d, "
+                "\"width\": %d, \"height\": %d, \"prepass\": %s},\n",
+                opt.objects, objects.empty() ? 0 : objects[0].nElements3, opt.passes, opt.frames,
+                opt.width, opt.height, opt.prepass ? "true" : "false");
+    printStats("cpu_submit_ms", cpuMs);
+    printStats("gpu_ms", gpuMs);
+    std::printf("  \"gl_calls_per_frame\": {\"total\": %llu, \"draw_calls\": %llu, \"drawn_vertices\": %llu, "
+                "\"program_binds\": %llu, \"uniform_updates\": %llu, \"vertex_array_binds\": %llu, "
+                "\"buffer_binds\": %llu, \"texture_binds\": %llu, \"framebuffer_binds\": %llu, "
+                "\"clears\": %llu, \"blits\": %llu, \"state_changes\": %llu, \"constant\": %s}\n}\n",
+                (unsigned long long)calls.total(), (unsigned long long)calls.drawCalls,
+                (unsigned long long)calls.drawnVertices, (unsigned long long)calls.programBinds,
+                (unsigned long long)calls.uniformUpdates, (unsigned long long)calls.vertexArrayBinds,
+                (unsigned long long)calls.bufferBinds, (unsigned long long)calls.textureBinds,
+                (unsigned long long)calls.framebufferBinds, (unsigned long long)calls.clears,
+                (unsigned long long)calls.blits, (unsigned long long)calls.stateChanges,
+                callsVary ? "false" : "true");
+    return 0;
+}
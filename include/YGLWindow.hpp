@@ -10,19 +10,34 @@
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#ifdef __APPLE__
 #include <OpenGL/gl.h>
+#endif
 #include <glm/glm.hpp>
 
 
-#ifdef __APPLE__
+#include <atomic>
 #include <thread>
+#include <algorithm>
+
+#ifdef __APPLE__
 #include <chrono>
 using namespace std::chrono_literals;
 #endif
 
 
+// Headless mode creates its context through EGL(Mesa llvmpipe works), so no display server is needed.
+// Opt in with `#define YGL_HEADLESS_EGL` before including YGL and link -lEGL; windowed builds stay EGL-free.
+#ifdef YGL_HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#endif
+
+
 #include <framebuffer.hpp>
 #include <program.hpp>
+#include <timing.hpp>
  
 
 
@@ -36,8 +51,19 @@ struct YGLWindowPool {
     }
     
     void registerWindow(YGLWindow* yw);
+    void unregisterWindow(YGLWindow* yw);
     YGLWindow* search(GLFWwindow* window);
     
+    /** glfwInit() on the first window, glfwTerminate() after the last one is gone.*/
+    void acquireGLFW();
+    void releaseGLFW();
+    
+    /** Run every registered window's main loop on its own render thread.
+     
+     Events are polled on the calling(main) thread, as GLFW requires. Returns when all windows are closed.
+     */
+    void mainLoop();
+    
     YGLWindowPool(const YGLWindowPool&) = delete;
     YGLWindowPool& operator=(const YGLWindowPool&) = delete;
     
@@ -46,67 +72,182 @@ private:
     ~YGLWindowPool() = default;
     
     std::vector<YGLWindow*> windows_;
+    int glfwUsers_ = 0;
 };
 
 
 
 
 
+/** How `glfwSwapBuffers` waits for the display.*/
+enum class SwapMode {
+    /** Wait for every vertical blank.*/
+    VSync,
+    /** Wait for vertical blank, but tear instead of waiting a whole extra refresh when the frame is late. Falls back to VSync if unsupported.*/
+    AdaptiveVSync,
+    /** Never wait.*/
+    Uncapped,
+};
+
+
 struct YGLWindow {
     typedef std::function<void()> YGLFunc;
+    typedef std::function<void(double dt)> YGLUpdateFunc;
     
     YGLWindow(const int width, const int height, const char* windowName) {
-        // APPLE Xcode bug.
-#ifdef __APPLE__
-        std::this_thread::sleep_for(1000ms);
-#endif
-        
-        // GLFW Init & Setting
-        glfwInit();
-        
-#ifdef __APPLE__
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
-        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-#endif
-        
-        window_ = glfwCreateWindow(width, height, windowName, 0, 0);
-        glfwMakeContextCurrent(window_);
-        
-        // GLEW Init
-        glewInit();
-        
-        // Some Settings
-        glfwSwapInterval(1);
-        
-        YGLWindowPool::get().registerWindow(this);
-        
-        
-        glfwSetFramebufferSizeCallback(window_, framebufferResizeCallback);
+        createWindow(width, height, windowName, nullptr);
+    }
+    
+    /** Create a window whose context shares GL objects with `share`'s context.
+     
+     Buffers, textures, shaders and programs are shared. Container objects(VAOs, framebuffers) are not, so create them in each window's own init function.
+     */
+    YGLWindow(const int width, const int height, const char* windowName, YGLWindow& share) {
+        createWindow(width, height, windowName, share.window_);
+    }
+    
+    /** Create a window, or a headless context when `headless` is true.
+     
+     Headless mode has no swapchain. Everything `Framebuffer::unbind()` would send to the screen goes to an offscreen `Framebuffer` instead, and `mainLoop` runs `maxFrames` frames as fast as possible.
+     
+     Needs `YGL_HEADLESS_EGL` defined before the include. Check `isOk()`: without EGL, or when EGL fails, there is no context.
+     
+     - Parameters:
+        - parameter headless: Create an EGL context without any window.
+     */
+    YGLWindow(const int width, const int height, const char* windowName, const bool headless) {
+        if (!headless) {
+            createWindow(width, height, windowName, nullptr);
+            return;
+        }
         
-        int w, h;
-        glfwGetFramebufferSize(window_, &w, &h);
-        framebufferResize(w, h);
+        headless_ = true;
+        maxFrames_ = 1;
+        ok_ = createHeadless(width, height);
     }
+    
     ~YGLWindow() {
+        if (headless_) {
+            destroyHeadless();
+            return;
+        }
+        YGLWindowPool::get().unregisterWindow(this);
         glfwDestroyWindow(window_);
-        glfwTerminate();
+        YGLWindowPool::get().releaseGLFW();
     }
     
     
     void initFunc  (YGLFunc init) { init_ = init; }
     void renderFunc(YGLFunc render) { render_ = render; }
     
+    /** Call `update` at a fixed rate, independent of the render rate.
+     
+     Each frame runs as many `dt = 1 / hz` steps as the elapsed time covers, then renders once. Use `interpolation()` in the render function to blend between the last two update states.
+     
+     - Parameters:
+        - parameter update: Simulation step, receives the fixed step in seconds.
+        - parameter hz: Update rate.
+     */
+    void updateFunc(YGLUpdateFunc update, const double hz = 60) {
+        update_ = update;
+        updateStep_ = 1.0 / hz;
+    }
+    
+    /** The function set by `updateFunc`, e.g. to suspend and restore it.*/
+    YGLUpdateFunc getUpdateFunc() const { return update_; }
+    double getUpdateHz() const { return 1.0 / updateStep_; }
+    
+    /** Fraction of a fixed update step left over after the latest update, in [0, 1).*/
+    double interpolation() { return interpolation_; }
+    
+    void swapMode(const SwapMode mode) {
+        swapMode_ = mode;
+        if (headless_) return;
+        
+        int interval = 1;
+        if (mode == SwapMode::Uncapped)
+            interval = 0;
+        else if (mode == SwapMode::AdaptiveVSync &&
+                 (glfwExtensionSupported("WGL_EXT_swap_control_tear") ||
+                  glfwExtensionSupported("GLX_EXT_swap_control_tear")))
+            interval = -1;
+        glfwSwapInterval(interval);
+    }
+    
+    /** Limit the frame rate. 0 removes the limit.*/
+    void frameRateCap(const double fps) { frameRateCap_ = fps; }
+    
+    /** CPU time of each frame(update and render calls, no swap or pacing wait).*/
+    FrameStats cpuFrameStats() { return cpuTimes_.stats(); }
+    /** Time between the starts of consecutive frames.*/
+    FrameStats frameStats() { return frameTimes_.stats(); }
+    
+    /** Stop `mainLoop` after `nFrames` frames. Negative value means no limit. */
+    void maxFrames(const int nFrames) { maxFrames_ = nFrames; }
+    int maxFrames() const { return maxFrames_; }
+    
+    bool shouldClose() {
+        if (maxFrames_ >= 0 && frameCount_ >= maxFrames_) return true;
+        if (headless_) return false;
+        if (closeRequested_ || glfwWindowShouldClose(window_)) return true;
+        // Keys can only be read on the main thread. The pool checks ESC for render threads.
+        return !renderThread_ && glfwGetKey(window_, GLFW_KEY_ESCAPE);
+    }
+    
     void mainLoop() {
+        if (!ok_) {
+            cerr << "Error on mainLoop: the window has no GL context." << endl;
+            return;
+        }
+        makeCurrent();
         init_();
         
-        while(!glfwWindowShouldClose(window_) && !glfwGetKey(window_, GLFW_KEY_ESCAPE)) {
+        frameCount_ = 0;
+        cpuTimes_.clear();
+        frameTimes_.clear();
+        
+        double accumulator = 0;
+        auto previous = timing::Clock::now();
+        auto deadline = previous;
+        while(!shouldClose()) {
+            if (resized_.exchange(false))
+                framebufferResize(pendingWidth_, pendingHeight_);
+            
+            auto frameStart = timing::Clock::now();
+            double elapsed = timing::seconds(frameStart - previous);
+            previous = frameStart;
+            if (frameCount_ > 0) frameTimes_.push(elapsed * 1000);
+            
+            if (update_) {
+                // Clamp so a hitch(breakpoint, window drag) does not trigger a burst of updates.
+                accumulator += std::min(elapsed, 0.25);
+                while (accumulator >= updateStep_) {
+                    update_(updateStep_);
+                    accumulator -= updateStep_;
+                }
+                interpolation_ = accumulator / updateStep_;
+            }
+            
             render_();
+            frameCount_++;
+            cpuTimes_.push(timing::milliseconds(timing::Clock::now() - frameStart));
             
-            glfwSwapBuffers(window_);
-            glfwPollEvents();
+            if (!headless_) {
+                glfwSwapBuffers(window_);
+                if (!renderThread_) glfwPollEvents();
+            }
+            
+            if (frameRateCap_ > 0) {
+                deadline += std::chrono::duration_cast<timing::Clock::duration>(std::chrono::duration<double>(1.0 / frameRateCap_));
+                // Fell behind, start pacing again from now instead of rushing to catch up.
+                auto now = timing::Clock::now();
+                if (deadline < now) deadline = now;
+                else timing::sleepUntil(deadline);
+            }
         }
+        
+        // Offscreen frames are not presented, so wait for them to actually finish.
+        if (headless_) glFinish();
     }
     void mainLoop(YGLFunc init, YGLFunc render) {
         initFunc(init);
@@ -119,9 +260,26 @@ struct YGLWindow {
     }
     
     
+    /** Read back RGBA8 pixels of the frame last rendered to the window(or headless target).
+     
+     Rows are bottom to top, as OpenGL returns them.
+     */
+    void readPixels(std::vector<GLubyte> &pixels) {
+        pixels.resize(size_t(width_) * height_ * 4);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, Framebuffer::defaultID);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    }
+    
+    
     
     
+    /** nullptr on a headless window.*/
     GLFWwindow* getGLFWWindow() { return window_; }
+    bool isHeadless() { return headless_; }
+    /** Whether the window(or headless context) and its GL context were created.*/
+    bool isOk() { return ok_; }
+    int frameCount() { return frameCount_; }
     
     void framebufferResize(const int width, const int height) {
         width_  = width;
@@ -129,23 +287,224 @@ struct YGLWindow {
         glViewport(0, 0, width_, height_);
     }
     
+    /** Deferred to the start of the next frame, since the context may be current on a render thread.*/
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height) {
         auto* win = YGLWindowPool::get().search(window);
-        if(win) win->framebufferResize(width, height);
+        if(win) {
+            win->pendingWidth_ = width;
+            win->pendingHeight_ = height;
+            win->resized_ = true;
+        }
         else cerr<<"Error on framebufferResizeCallback's window pointer"<<endl;
     }
     
+    /** Make this window's context current on the calling thread, with `Framebuffer::defaultID` set to its default framebuffer. `mainLoop` does it first; call it before other GL work when several windows share a thread.*/
+    void makeCurrent() {
+        if (headless_) {
+#ifdef YGL_HEADLESS_EGL
+            eglMakeCurrent(display_, surface_, surface_, context_);
+#endif
+            Framebuffer::defaultID = target_.id;
+        } else {
+            glfwMakeContextCurrent(window_);
+            Framebuffer::defaultID = 0;
+        }
+    }
+    
     int width() { return width_; }
     int height() { return height_; }
     int aspect() { return width_/(float)height_; }
     
+private:
+    friend struct YGLWindowPool;
+    
+    /** Body of a render thread started by `YGLWindowPool::mainLoop()`.*/
+    void renderThreadLoop() {
+        makeCurrent();
+        // Debug output state is tracked per thread; re-enable it for this one.
+        if (debugOutput_) GLDebug::get().enable();
+        mainLoop();
+        glfwMakeContextCurrent(nullptr);
+        running_ = false;
+        // Wake the main thread so it notices this window finished.
+        glfwPostEmptyEvent();
+    }
+    
+    void createWindow(const int width, const int height, const char* windowName, GLFWwindow* share) {
+        // APPLE Xcode bug.
+#ifdef __APPLE__
+        std::this_thread::sleep_for(1000ms);
+#endif
+        
+        // GLFW Init & Setting
+        YGLWindowPool::get().acquireGLFW();
+        
+#ifdef __APPLE__
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#endif
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, YGL_GL_CHECKS ? GL_TRUE : GL_FALSE);
+        
+        window_ = glfwCreateWindow(width, height, windowName, 0, share);
+        if (!window_) {
+            cerr << "Error on YGLWindow: glfwCreateWindow failed." << endl;
+            return;
+        }
+        makeCurrent();
+        
+        // GLEW Init
+        glewInit();
+        debugOutput_ = GLDebug::get().enable();
+        
+        // Some Settings
+        swapMode(swapMode_);
+        
+        YGLWindowPool::get().registerWindow(this);
+        
+        
+        glfwSetFramebufferSizeCallback(window_, framebufferResizeCallback);
+        
+        int w, h;
+        glfwGetFramebufferSize(window_, &w, &h);
+        framebufferResize(w, h);
+        ok_ = true;
+    }
+    
+    /** - Returns: false if no context could be made; the window is then unusable.*/
+    bool createHeadless(const int width, const int height) {
+#ifdef YGL_HEADLESS_EGL
+        // Surfaceless Mesa platform first; it needs neither X11 nor a GPU device.
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay)
+            display_ = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display_ == EGL_NO_DISPLAY)
+            display_ = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        
+        EGLint major, minor;
+        if (display_ == EGL_NO_DISPLAY || !eglInitialize(display_, &major, &minor)) {
+            cerr << "Error on headless YGLWindow: EGL display initialization failed." << endl;
+            display_ = EGL_NO_DISPLAY;
+            return false;
+        }
+        displayUsers_++;
+        
+        const EGLint configAttribs[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+            EGL_NONE
+        };
+        EGLConfig config;
+        EGLint nConfigs = 0;
+        eglChooseConfig(display_, configAttribs, &config, 1, &nConfigs);
+        if (nConfigs == 0) {
+            cerr << "Error on headless YGLWindow: no EGL config supports desktop OpenGL." << endl;
+            releaseDisplay();
+            return false;
+        }
+        
+        eglBindAPI(EGL_OPENGL_API);
+        const EGLint contextAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 1,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_CONTEXT_OPENGL_DEBUG, YGL_GL_CHECKS ? EGL_TRUE : EGL_FALSE,
+            EGL_NONE
+        };
+        context_ = eglCreateContext(display_, config, EGL_NO_CONTEXT, contextAttribs);
+        if (context_ == EGL_NO_CONTEXT) {
+            cerr << "Error on headless YGLWindow: EGL context creation failed." << endl;
+            releaseDisplay();
+            return false;
+        }
+        
+        // The pbuffer is never drawn to. It only exists for drivers without surfaceless contexts.
+        const char* extensions = eglQueryString(display_, EGL_EXTENSIONS);
+        if (!extensions || !strstr(extensions, "EGL_KHR_surfaceless_context")) {
+            const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+            surface_ = eglCreatePbufferSurface(display_, config, pbufferAttribs);
+        }
+        eglMakeCurrent(display_, surface_, surface_, context_);
+        
+        // glewInit() asks GLX for the display, which does not exist here.
+        glewExperimental = GL_TRUE;
+        glewContextInit();
+        debugOutput_ = GLDebug::get().enable();
+        
+        target_.init(width, height);
+        target_.attachTexture2D(1, GL_RGBA8);
+        target_.attachRenderBuffer(GL_DEPTH24_STENCIL8);
+        makeCurrent();
+        glBindFramebuffer(GL_FRAMEBUFFER, target_.id);
+        
+        framebufferResize(width, height);
+        return true;
+#else
+        (void)width;
+        (void)height;
+        cerr << "Error on headless YGLWindow: built without EGL. Define YGL_HEADLESS_EGL before including YGLWindow.hpp." << endl;
+        return false;
+#endif
+    }
+    
+    void destroyHeadless() {
+#ifdef YGL_HEADLESS_EGL
+        if (context_ == EGL_NO_CONTEXT) return;
+        
+        // Another window's context may be current; the target belongs to this one.
+        makeCurrent();
+        target_.cleanup();
+        Framebuffer::defaultID = 0;
+        GLDebug::get().disable();
+        
+        eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (surface_ != EGL_NO_SURFACE) eglDestroySurface(display_, surface_);
+        eglDestroyContext(display_, context_);
+        releaseDisplay();
+#endif
+    }
+    
 private:
     GLFWwindow* window_ = nullptr;
     int width_, height_;
     
+    bool headless_ = false;
+    bool ok_ = false;
+    bool debugOutput_ = false;
+    int maxFrames_ = -1;
+    int frameCount_ = 0;
+    Framebuffer target_;
+#ifdef YGL_HEADLESS_EGL
+    EGLDisplay display_ = EGL_NO_DISPLAY;
+    EGLContext context_ = EGL_NO_CONTEXT;
+    EGLSurface surface_ = EGL_NO_SURFACE;
+    /** Headless windows using the display. Windows get the same display, and terminating it destroys every context on it.*/
+    static inline int displayUsers_ = 0;
+    
+    void releaseDisplay() {
+        if (--displayUsers_ == 0) eglTerminate(display_);
+    }
+#endif
+    
     const YGLFunc defRenderFunc = [](){};
     YGLFunc render_ = defRenderFunc;
     YGLFunc init_   = defRenderFunc;
+    YGLUpdateFunc update_;
+    
+    double updateStep_ = 1.0 / 60;
+    double interpolation_ = 0;
+    SwapMode swapMode_ = SwapMode::VSync;
+    double frameRateCap_ = 0;
+    FrameTimeHistory cpuTimes_;
+    FrameTimeHistory frameTimes_;
+    
+    bool renderThread_ = false;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> closeRequested_{false};
+    std::atomic<bool> resized_{false};
+    std::atomic<int> pendingWidth_{0}, pendingHeight_{0};
 };
 
 
@@ -155,13 +514,52 @@ private:
 
 inline void YGLWindowPool::registerWindow(YGLWindow* yw) {
     windows_.push_back(yw);
+    glfwSetWindowUserPointer(yw->getGLFWWindow(), yw);
+}
+
+inline void YGLWindowPool::unregisterWindow(YGLWindow* yw) {
+    windows_.erase(std::remove(windows_.begin(), windows_.end(), yw), windows_.end());
 }
 
 inline YGLWindow* YGLWindowPool::search(GLFWwindow* window) {
+    return static_cast<YGLWindow*>(glfwGetWindowUserPointer(window));
+}
+
+inline void YGLWindowPool::acquireGLFW() {
+    if (glfwUsers_++ == 0) glfwInit();
+}
+
+inline void YGLWindowPool::releaseGLFW() {
+    if (--glfwUsers_ == 0) glfwTerminate();
+}
+
+inline void YGLWindowPool::mainLoop() {
+    // A context can only be current on one thread at a time.
+    glfwMakeContextCurrent(nullptr);
+    
+    std::vector<std::thread> threads;
     for (auto *yw : windows_) {
-        if (yw->getGLFWWindow() == window) return yw;
+        yw->renderThread_ = true;
+        yw->closeRequested_ = false;
+        yw->running_ = true;
     }
-    return nullptr;
+    for (auto *yw : windows_)
+        threads.emplace_back([yw]() { yw->renderThreadLoop(); });
+    
+    bool anyRunning = true;
+    while (anyRunning) {
+        glfwWaitEventsTimeout(0.1);
+        
+        anyRunning = false;
+        for (auto *yw : windows_) {
+            if (glfwGetKey(yw->getGLFWWindow(), GLFW_KEY_ESCAPE))
+                yw->closeRequested_ = true;
+            anyRunning = anyRunning || yw->running_;
+        }
+    }
+    
+    for (auto &t : threads) t.join();
+    for (auto *yw : windows_) yw->renderThread_ = false;
 }
 
 #endif
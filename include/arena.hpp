@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+/** Monotonic allocator for short-lived scratch memory, e.g. the temporaries of `ObjData::loadObject`.
+
+ Allocation bumps a pointer in the current block; nothing is freed until `release` or the destructor frees every block at once. Containers that grow in an arena leave their old storage behind, so reserve them when the size is known.
+
+ ```
+ Arena arena;
+ ArenaVector<glm::uvec2> corners{ArenaAllocator<glm::uvec2>(arena)};
+ corners.reserve(n);
+ ```
+ Not thread safe: one arena per thread or per load.
+ */
+struct Arena {
+    /** - parameter blockBytes: Size of each block. Larger allocations get a block of their own.*/
+    explicit Arena(const size_t blockBytes = 1 << 20) : blockBytes(blockBytes) {}
+    ~Arena() { release(); }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(const size_t bytes, const size_t alignment = alignof(std::max_align_t)) {
+        uintptr_t p = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~uintptr_t(alignment - 1);
+        if (cursor == nullptr || p + bytes > reinterpret_cast<uintptr_t>(limit)) {
+            const size_t size = std::max(blockBytes, bytes + alignment);
+            char *block = static_cast<char *>(::operator new(size));
+            blocks.push_back(block);
+            reserved += size;
+            cursor = block;
+            limit = block + size;
+            p = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~uintptr_t(alignment - 1);
+        }
+        cursor = reinterpret_cast<char *>(p + bytes);
+        used += bytes;
+        return reinterpret_cast<void *>(p);
+    }
+
+    /** Free all blocks. Everything allocated from the arena becomes invalid.*/
+    void release() {
+        for (char *block : blocks) ::operator delete(block);
+        blocks.clear();
+        cursor = limit = nullptr;
+        reserved = used = 0;
+    }
+
+    /** Bytes handed out since the last `release`.*/
+    size_t usedBytes() const { return used; }
+    /** Bytes of all blocks.*/
+    size_t reservedBytes() const { return reserved; }
+
+private:
+    size_t blockBytes;
+    std::vector<char *> blocks;
+    char *cursor = nullptr;
+    char *limit = nullptr;
+    size_t reserved = 0;
+    size_t used = 0;
+};
+
+/** Standard allocator on an `Arena`. `deallocate` does nothing; the arena frees everything at once.*/
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    Arena *arena;
+
+    explicit ArenaAllocator(Arena &arena) : arena(&arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(const size_t n) { return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T *, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U> &other) const { return arena != other.arena; }
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
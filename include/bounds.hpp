@@ -0,0 +1,85 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/** Axis aligned bounding box.
+
+ Build it from `ObjData::minPos`, `maxPos` and move it to world space with `transformed`.
+ */
+struct AABB {
+    glm::vec3 min = glm::vec3( std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+    AABB() = default;
+    AABB(const glm::vec3 &min, const glm::vec3 &max) : min(min), max(max) {}
+
+    bool isEmpty() const {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 extent() const { return (max - min) * 0.5f; }
+
+    glm::vec3 corner(const int i) const {
+        return glm::vec3(i & 1 ? max.x : min.x,
+                         i & 2 ? max.y : min.y,
+                         i & 4 ? max.z : min.z);
+    }
+
+    void expand(const glm::vec3 &p) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    void expand(const AABB &b) {
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
+
+    /** Bounds of this box after `m`, e.g. a model matrix.
+
+     Uses the center/extent form(Arvo), so it costs one matrix-vector product instead of eight.
+     */
+    AABB transformed(const glm::mat4 &m) const {
+        glm::vec3 c = glm::vec3(m * glm::vec4(center(), 1));
+        glm::vec3 e = extent();
+        glm::vec3 r;
+        for (int i = 0; i < 3; i++)
+            r[i] = std::abs(m[0][i]) * e.x + std::abs(m[1][i]) * e.y + std::abs(m[2][i]) * e.z;
+        return AABB(c - r, c + r);
+    }
+};
+
+/** Half line `origin + t * direction`, t >= 0. The direction need not be unit length.*/
+struct Ray {
+    glm::vec3 origin = glm::vec3(0);
+    glm::vec3 direction = glm::vec3(0, 0, -1);
+
+    glm::vec3 at(const float t) const { return origin + t * direction; }
+
+    /** This ray after `m`. The direction is not renormalized, so `t` means the same point before and after.*/
+    Ray transformed(const glm::mat4 &m) const {
+        return {glm::vec3(m * glm::vec4(origin, 1)), glm::vec3(m * glm::vec4(direction, 0))};
+    }
+
+    /** Where the ray enters `box`(slab test), if before `tMax`.
+
+     - Parameters:
+        - parameter inverseDirection: 1 / `direction`, computed once per ray.
+     */
+    bool intersects(const glm::vec3 &min, const glm::vec3 &max, const glm::vec3 &inverseDirection,
+                    const float tMax, float &tEntry) const {
+        glm::vec3 t0 = (min - origin) * inverseDirection, t1 = (max - origin) * inverseDirection;
+        glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+        tEntry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.f));
+        float tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+        return tEntry <= tExit;
+    }
+
+    bool intersects(const AABB &box, const float tMax, float &tEntry) const {
+        return intersects(box.min, box.max, 1.f / direction, tMax, tEntry);
+    }
+};
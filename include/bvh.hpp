@@ -0,0 +1,469 @@
+#pragma once
+
+#include <GL/glew.h> // GLuint
+#include <glm/glm.hpp>
+
+#include <bounds.hpp>
+#include <objreader.hpp>
+#include <threadpool.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+/** Closest hit of a ray, from `TriangleBVH::intersect` or `Picker::pick`.*/
+struct RayHit {
+    /** Ray parameter of the hit: the point is `ray.at(t)`. Infinity for no hit.*/
+    float t = std::numeric_limits<float>::infinity();
+    /** Index of the triangle in `ObjData::elements3`.*/
+    GLuint triangle = 0;
+    /** Weights of the triangle's second and third vertex; the first gets 1 - x - y.*/
+    glm::vec2 barycentric = glm::vec2(0);
+    /** Index of the object in the `Picker`.*/
+    size_t object = 0;
+
+    bool isHit() const { return t < std::numeric_limits<float>::infinity(); }
+};
+
+/** Bounding volume hierarchy over the triangles of a mesh, for ray queries like picking.
+
+ Built with the surface area heuristic over 16 bins per axis. The top of the tree is split with the binning spread over the `ThreadPool`, then the subtrees below are built in parallel; the result is the same tree for any number of threads. Nodes are stored depth first in one array of 32-byte nodes: a node's left child is the next node, so traversal mostly walks forward through memory.
+
+ ```
+ TriangleBVH bvh;
+ bvh.build(obj);             // before releaseCPUData: it reads vertices and elements3
+ RayHit hit;
+ if (bvh.intersect(ray, hit)) ... hit.triangle, hit.barycentric ...
+ ```
+ The BVH keeps its own copy of the triangles, so it stays valid when the mesh releases its CPU data, but not when the mesh is edited.
+ */
+struct TriangleBVH {
+    struct Node {
+        glm::vec3 min;
+        /** Inner node: index of the right child(the left one is the next node). Leaf: first triangle in `triangles`.*/
+        GLuint index;
+        glm::vec3 max;
+        /** Triangles of a leaf, 0 for inner nodes.*/
+        GLuint count;
+    };
+
+    /** A triangle as its first vertex and two edges, ready for the ray test.*/
+    struct Triangle {
+        glm::vec3 v0, edge1, edge2;
+    };
+
+    /** Leaves get at most this many triangles when splitting is worth it, and never more than `maxLeafSize`.*/
+    GLuint leafSize = 4;
+    GLuint maxLeafSize = 32;
+
+    std::vector<Node> nodes;
+    /** Triangles in leaf order.*/
+    std::vector<Triangle> triangles;
+    /** `ObjData::elements3` index of each entry of `triangles`.*/
+    std::vector<GLuint> triangleIDs;
+
+    void build(const ObjData &obj) { build(obj.vertices, obj.elements3); }
+
+    void build(const std::vector<glm::vec3> &vertices, const std::vector<glm::uvec3> &elements) {
+        nodes.clear();
+        triangles.clear();
+        triangleIDs.clear();
+        const size_t n = elements.size();
+        if (n == 0) return;
+        ThreadPool &pool = ThreadPool::get();
+
+        items.resize(n);
+        pool.parallelFor(n, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const glm::uvec3 &e = elements[i];
+                AABB box;
+                for (int k = 0; k < 3; k++) box.expand(vertices[e[k]]);
+                items[i] = {box, box.center(), GLuint(i)};
+            }
+        });
+
+        // Top of the tree, split until there are enough subtrees to keep every thread busy. Both halves
+        // make the same decisions, so where the cut falls does not change the tree.
+        const GLuint taskSize = GLuint(std::max<size_t>(n / (pool.size() * 4), 1 << 12));
+        std::vector<TopNode> top;
+        buildTop(top, 0, GLuint(n), 0, rangeBounds(0, GLuint(n), false, true), taskSize);
+
+        std::vector<std::vector<Node>> subtrees(tasks.size());
+        pool.parallelFor(tasks.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) buildNode(subtrees[i], tasks[i].first, tasks[i].count, tasks[i].depth, tasks[i].box);
+        }, 1);
+
+        // Depth-first layout of the whole tree.
+        size_t total = 0;
+        for (auto &s : subtrees) total += s.size();
+        nodes.reserve(top.size() + total);
+        flatten(top, 0, subtrees);
+
+        triangles.resize(n);
+        triangleIDs.resize(n);
+        pool.parallelFor(n, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                triangleIDs[i] = items[i].id;
+                const glm::uvec3 &e = elements[items[i].id];
+                triangles[i] = {vertices[e.x], vertices[e.y] - vertices[e.x], vertices[e.z] - vertices[e.x]};
+            }
+        });
+
+        std::vector<Item>().swap(items);
+        tasks.clear();
+    }
+
+    /** Closest hit of `ray` nearer than `hit.t`. Triangles count from both sides.
+
+     - Returns: true if `hit` was updated.
+     */
+    bool intersect(const Ray &ray, RayHit &hit) const {
+        if (nodes.empty()) return false;
+        const glm::vec3 inverseDirection = 1.f / ray.direction;
+        bool found = false;
+
+        // Depth is bounded in `buildNode`, so the stack cannot overflow.
+        GLuint stack[maxDepth + 1];
+        float stackT[maxDepth + 1];
+        int top = 0;
+        float tEntry;
+        if (!ray.intersects(nodes[0].min, nodes[0].max, inverseDirection, hit.t, tEntry)) return false;
+        GLuint i = 0;
+        for (;;) {
+            const Node &node = nodes[i];
+            if (node.count > 0) {
+                for (GLuint k = node.index; k < node.index + node.count; k++)
+                    if (intersect(ray, triangles[k], hit)) {
+                        hit.triangle = triangleIDs[k];
+                        found = true;
+                    }
+            } else {
+                GLuint near = i + 1, far = node.index;
+                float tNear, tFar;
+                bool hitNear = ray.intersects(nodes[near].min, nodes[near].max, inverseDirection, hit.t, tNear);
+                bool hitFar = ray.intersects(nodes[far].min, nodes[far].max, inverseDirection, hit.t, tFar);
+                if (hitNear && hitFar) {
+                    if (tFar < tNear) {
+                        std::swap(near, far);
+                        std::swap(tNear, tFar);
+                    }
+                    stack[top] = far;
+                    stackT[top++] = tFar;
+                    i = near;
+                    continue;
+                }
+                if (hitNear || hitFar) {
+                    i = hitNear ? near : far;
+                    continue;
+                }
+            }
+            // Next subtree that can still beat the closest hit.
+            do {
+                if (top == 0) return found;
+                i = stack[--top];
+            } while (stackT[top] > hit.t);
+        }
+    }
+
+    /** Test every triangle, for checking `intersect`.*/
+    bool intersectAll(const Ray &ray, RayHit &hit) const {
+        bool found = false;
+        for (size_t k = 0; k < triangles.size(); k++)
+            if (intersect(ray, triangles[k], hit)) {
+                hit.triangle = triangleIDs[k];
+                found = true;
+            }
+        return found;
+    }
+
+    /** Bounds of the whole mesh.*/
+    AABB bounds() const { return nodes.empty() ? AABB() : AABB(nodes[0].min, nodes[0].max); }
+
+    size_t memoryBytes() const {
+        return nodes.size() * sizeof(Node) + triangles.size() * sizeof(Triangle) + triangleIDs.size() * sizeof(GLuint);
+    }
+
+private:
+    static constexpr int bins = 16;
+    /** Deepest node. Below `sahDepth` splits fall back to halving, which ends within 32 more levels.*/
+    static constexpr int sahDepth = 64;
+    static constexpr int maxDepth = sahDepth + 33;
+
+    struct Bins {
+        AABB box[3][bins];
+        GLuint count[3][bins] = {};
+
+        static Bins merge(Bins a, const Bins &b) {
+            for (int axis = 0; axis < 3; axis++)
+                for (int i = 0; i < bins; i++) {
+                    a.box[axis][i].expand(b.box[axis][i]);
+                    a.count[axis][i] += b.count[axis][i];
+                }
+            return a;
+        }
+    };
+
+    /** A triangle while building, moved around by the partitions so each node's triangles stay contiguous.*/
+    struct Item {
+        AABB box;
+        glm::vec3 centroid;
+        GLuint id;
+    };
+
+    struct Split {
+        int axis = -1;
+        /** Triangles in bins below this go left.*/
+        int bin = 0;
+        float cost = std::numeric_limits<float>::infinity();
+        /** Bounds of the two sides, known from the bins.*/
+        AABB left, right;
+    };
+
+    /** Node of the top of the tree; `task` >= 0 marks a subtree built in parallel.*/
+    struct TopNode {
+        AABB box;
+        int left = -1, right = -1;
+        GLuint first = 0, count = 0;
+        int task = -1;
+    };
+
+    struct Task {
+        GLuint first, count;
+        int depth;
+        AABB box;
+    };
+
+    static float area(const AABB &box) {
+        if (box.isEmpty()) return 0;
+        glm::vec3 d = box.max - box.min;
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+
+    static int binOf(const float c, const float min, const float scale) {
+        return std::min(bins - 1, std::max(0, int((c - min) * scale)));
+    }
+
+    /** Bounds of the triangles of items[first, first + count), or of their centroids.*/
+    AABB rangeBounds(const GLuint first, const GLuint count, const bool ofCentroids, const bool parallel) const {
+        auto map = [&](size_t begin, size_t end) {
+            AABB b;
+            for (size_t i = first + begin; i < first + end; i++) {
+                if (ofCentroids) b.expand(items[i].centroid);
+                else b.expand(items[i].box);
+            }
+            return b;
+        };
+        return parallel ? ThreadPool::get().reduce(count, AABB(), map, [](AABB a, const AABB &b) {
+                              a.expand(b);
+                              return a;
+                          })
+                        : map(0, count);
+    }
+
+    /** Cheapest binned SAH split of items[first, first + count). Costs are relative: one per triangle per unit of parent area.*/
+    Split findSplit(const GLuint first, const GLuint count, const AABB &centroidBox, const bool parallel) const {
+        const glm::vec3 extent = centroidBox.max - centroidBox.min;
+        glm::vec3 scale;
+        for (int axis = 0; axis < 3; axis++) scale[axis] = extent[axis] > 0 ? bins / extent[axis] : 0;
+
+        auto map = [&](size_t begin, size_t end) {
+            Bins b;
+            for (size_t i = first + begin; i < first + end; i++) {
+                const Item &item = items[i];
+                for (int axis = 0; axis < 3; axis++) {
+                    if (scale[axis] == 0) continue;
+                    int bin = binOf(item.centroid[axis], centroidBox.min[axis], scale[axis]);
+                    b.box[axis][bin].expand(item.box);
+                    b.count[axis][bin]++;
+                }
+            }
+            return b;
+        };
+        Bins b = parallel ? ThreadPool::get().reduce(count, Bins(), map, Bins::merge) : map(0, count);
+
+        Split best;
+        for (int axis = 0; axis < 3; axis++) {
+            if (scale[axis] == 0) continue;
+            // Sweep from the right, then from the left: cost of splitting below bin i.
+            AABB rightBox[bins];
+            GLuint rightCount[bins];
+            AABB box;
+            GLuint n = 0;
+            for (int i = bins - 1; i > 0; i--) {
+                box.expand(b.box[axis][i]);
+                n += b.count[axis][i];
+                rightBox[i] = box;
+                rightCount[i] = n;
+            }
+            box = AABB();
+            n = 0;
+            for (int i = 1; i < bins; i++) {
+                box.expand(b.box[axis][i - 1]);
+                n += b.count[axis][i - 1];
+                if (n == 0 || rightCount[i] == 0) continue;
+                float cost = area(box) * n + area(rightBox[i]) * rightCount[i];
+                if (cost < best.cost) best = {axis, i, cost, box, rightBox[i]};
+            }
+        }
+        return best;
+    }
+
+    /** Split items[first, first + count): by `split`, or in half by index if there is none, which also fills in the bounds of the halves.
+
+     - Returns: First index of the right half.
+     */
+    GLuint partition(const GLuint first, const GLuint count, Split &split, const AABB &centroidBox, const bool parallel) {
+        if (split.axis < 0) {
+            const GLuint middle = first + count / 2;
+            split.left = rangeBounds(first, middle - first, false, parallel);
+            split.right = rangeBounds(middle, first + count - middle, false, parallel);
+            return middle;
+        }
+        const int axis = split.axis;
+        const float min = centroidBox.min[axis], scale = bins / (centroidBox.max[axis] - centroidBox.min[axis]);
+        auto middle = std::partition(items.begin() + first, items.begin() + first + count, [&](const Item &item) {
+            return binOf(item.centroid[axis], min, scale) < split.bin;
+        });
+        return GLuint(middle - items.begin());
+    }
+
+    /** Whether to split a node, and how: by `split`, or in half when `split.axis` is -1.*/
+    bool chooseSplit(const GLuint first, const GLuint count, const int depth, const AABB &box, const AABB &centroidBox,
+                     const bool parallel, Split &split) const {
+        if (count <= leafSize) return false;
+        split = Split();
+        if (depth < sahDepth) split = findSplit(first, count, centroidBox, parallel);
+        // A leaf costs one test per triangle; a split, one node test plus the children's triangles by area.
+        const float splitCost = 1 + split.cost / std::max(area(box), std::numeric_limits<float>::min());
+        if (split.axis >= 0 && splitCost < float(count)) return true;
+        if (count <= maxLeafSize) return false;
+        split.axis = -1;
+        return true;
+    }
+
+    /** `box` is the node's bounds, passed down from the parent's split.*/
+    void buildTop(std::vector<TopNode> &top, const GLuint first, const GLuint count, const int depth, const AABB &box,
+                  const GLuint taskSize) {
+        const int index = int(top.size());
+        top.push_back(TopNode());
+        top[index].box = box;
+        top[index].first = first;
+        top[index].count = count;
+        Split split;
+        if (count > taskSize) {
+            const AABB centroidBox = rangeBounds(first, count, true, true);
+            if (chooseSplit(first, count, depth, box, centroidBox, true, split)) {
+                const GLuint middle = partition(first, count, split, centroidBox, true);
+                buildTop(top, first, middle - first, depth + 1, split.left, taskSize);
+                top[index].left = index + 1;
+                top[index].right = int(top.size());
+                buildTop(top, middle, first + count - middle, depth + 1, split.right, taskSize);
+                return;
+            }
+        }
+        top[index].task = int(tasks.size());
+        tasks.push_back({first, count, depth, box});
+    }
+
+    /** Build the subtree of items[first, first + count) depth first into `out`, with indices relative to `out`.*/
+    void buildNode(std::vector<Node> &out, const GLuint first, const GLuint count, const int depth, const AABB &box) {
+        const GLuint index = GLuint(out.size());
+        out.push_back({box.min, first, box.max, count});
+        if (count <= leafSize) return;
+        const AABB centroidBox = rangeBounds(first, count, true, false);
+        Split split;
+        if (!chooseSplit(first, count, depth, box, centroidBox, false, split)) return;
+        const GLuint middle = partition(first, count, split, centroidBox, false);
+        out[index].count = 0;
+        buildNode(out, first, middle - first, depth + 1, split.left);
+        out[index].index = GLuint(out.size());
+        buildNode(out, middle, first + count - middle, depth + 1, split.right);
+    }
+
+    void flatten(const std::vector<TopNode> &top, const int i, const std::vector<std::vector<Node>> &subtrees) {
+        const TopNode &t = top[i];
+        if (t.task >= 0) {
+            // Subtree indices are relative to its own array.
+            const GLuint offset = GLuint(nodes.size());
+            for (Node node : subtrees[t.task]) {
+                if (node.count == 0) node.index += offset;
+                nodes.push_back(node);
+            }
+            return;
+        }
+        const size_t index = nodes.size();
+        nodes.push_back({t.box.min, 0, t.box.max, 0});
+        flatten(top, t.left, subtrees);
+        nodes[index].index = GLuint(nodes.size());
+        flatten(top, t.right, subtrees);
+    }
+
+    /** Möller-Trumbore ray/triangle test. Updates `hit.t` and `hit.barycentric` if nearer.*/
+    static bool intersect(const Ray &ray, const Triangle &tri, RayHit &hit) {
+        const glm::vec3 p = glm::cross(ray.direction, tri.edge2);
+        const float det = glm::dot(tri.edge1, p);
+        if (det == 0) return false;
+        const float inverseDet = 1 / det;
+        const glm::vec3 s = ray.origin - tri.v0;
+        const float u = glm::dot(s, p) * inverseDet;
+        if (u < 0 || u > 1) return false;
+        const glm::vec3 q = glm::cross(s, tri.edge1);
+        const float v = glm::dot(ray.direction, q) * inverseDet;
+        if (v < 0 || u + v > 1) return false;
+        const float t = glm::dot(tri.edge2, q) * inverseDet;
+        if (t < 0 || t >= hit.t) return false;
+        hit.t = t;
+        hit.barycentric = glm::vec2(u, v);
+        return true;
+    }
+
+    // Build scratch.
+    std::vector<Item> items;
+    std::vector<Task> tasks;
+};
+
+/** Objects to pick from: a BVH and a model matrix each.
+
+ ```
+ picker.clear();
+ picker.add(bvh, model);
+ CameraInput input = camera.takeInput();
+ if (input.clicked) {
+     RayHit hit = picker.pick(camera.cursorRay(input.clickX, input.clickY, width, height, zNear, zFar));
+     if (hit.isHit()) ... hit.object, hit.triangle, hit.barycentric ...
+ }
+ ```
+ */
+struct Picker {
+    struct Object {
+        const TriangleBVH *bvh;
+        glm::mat4 model;
+        glm::mat4 inverseModel;
+        AABB worldBounds;
+    };
+
+    std::vector<Object> objects;
+
+    /** - Returns: Index of the object, reported as `RayHit::object`.*/
+    size_t add(const TriangleBVH &bvh, const glm::mat4 &model = glm::mat4(1)) {
+        objects.push_back({&bvh, model, glm::inverse(model), bvh.bounds().transformed(model)});
+        return objects.size() - 1;
+    }
+
+    void clear() { objects.clear(); }
+
+    /** Closest hit of a world-space ray. `t` is in units of the ray's direction, e.g. world units for `Camera::cursorRay`.*/
+    RayHit pick(const Ray &ray) const {
+        RayHit hit;
+        const glm::vec3 inverseDirection = 1.f / ray.direction;
+        for (size_t i = 0; i < objects.size(); i++) {
+            const Object &o = objects[i];
+            float tEntry;
+            if (!ray.intersects(o.worldBounds.min, o.worldBounds.max, inverseDirection, hit.t, tEntry)) continue;
+            // In model space the direction keeps its scale, so t is the same as in world space.
+            if (o.bvh->intersect(ray.transformed(o.inverseModel), hit)) hit.object = i;
+        }
+        return hit;
+    }
+};
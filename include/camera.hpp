@@ -20,8 +20,36 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/transform.hpp>
 
+#include <bounds.hpp>
+
+#include <cmath>
+
 void cursorPosCallback(GLFWwindow *window, double xpos, double ypos);
 void scrollCallback(GLFWwindow *window, double xoffset, double yoffset);
+void mouseButtonCallback(GLFWwindow *window, int button, int action, int mods);
+
+namespace comp {
+float min(const float &a, const float &b) {
+    return a > b ? b : a;
+}
+float max(const float &a, const float &b) {
+    return a > b ? a : b;
+}
+float clamp(const float &value, const float &left, const float &right) {
+    return max(left, min(value, right));
+}
+}
+
+/** User input applied to the camera, accumulated until taken.*/
+struct CameraInput {
+    /** Cursor drag in fractions of the window size.*/
+    float dx = 0, dy = 0;
+    float scroll = 0;
+    /** Left button pressed and released without dragging, e.g. to pick with `Camera::cursorRay`.*/
+    bool clicked = false;
+    /** Cursor position of the click, in window coordinates(origin top left).*/
+    double clickX = 0, clickY = 0;
+};
 
 struct Camera {
     
@@ -34,72 +62,142 @@ struct Camera {
     glm::vec3 look = glm::vec3(0, 0, 0);
     glm::vec3 up = glm::vec3(0, 1, 0);
     
-    float theta;
-    float phi;
+    float theta = 0;
+    float phi = 0;
     float fovy = 45.f;
     
 private:
     glm::vec3 curPosition = glm::vec3(0, 0, 10);
     
+    // Matrices are rebuilt only when their inputs change. NaN forces the first build.
+    glm::mat4 rotate_, view_, projection_;
+    float rotateKey_[2] = {NAN, NAN};
+    glm::vec3 viewKey_[3] = {glm::vec3(NAN), glm::vec3(NAN), glm::vec3(NAN)};
+    float projectionKey_[4] = {NAN, NAN, NAN, NAN};
+    
 public:
-    glm::mat4 getRotate() {
-        glm::mat4 rotY = glm::rotate(theta, glm::vec3(0, 1, 0));
-        glm::mat4 rotX = glm::rotate(phi, glm::vec3(1, 0, 0));
-        return rotY * rotX;
+    const glm::mat4& getRotate() {
+        if (theta != rotateKey_[0] || phi != rotateKey_[1]) {
+            glm::mat4 rotY = glm::rotate(theta, glm::vec3(0, 1, 0));
+            glm::mat4 rotX = glm::rotate(phi, glm::vec3(1, 0, 0));
+            rotate_ = rotY * rotX;
+            rotateKey_[0] = theta;
+            rotateKey_[1] = phi;
+        }
+        return rotate_;
     }
     
     void rotatePosition() {
         curPosition = getRotate() * glm::vec4(initPosition, 1);
     }
     
-    glm::mat4 lookAt() {
-        return glm::lookAt(curPosition, look, up);
+    const glm::mat4& lookAt() {
+        if (curPosition != viewKey_[0] || look != viewKey_[1] || up != viewKey_[2]) {
+            view_ = glm::lookAt(curPosition, look, up);
+            viewKey_[0] = curPosition;
+            viewKey_[1] = look;
+            viewKey_[2] = up;
+        }
+        return view_;
+    }
+    
+    const glm::mat4& perspective(float aspect, float zNear, float zFar) {
+        if (fovy != projectionKey_[0] || aspect != projectionKey_[1] ||
+            zNear != projectionKey_[2] || zFar != projectionKey_[3]) {
+            projection_ = glm::perspective(fovy * PI / 180.f, aspect, zNear, zFar);
+            projectionKey_[0] = fovy;
+            projectionKey_[1] = aspect;
+            projectionKey_[2] = zNear;
+            projectionKey_[3] = zFar;
+        }
+        return projection_;
+    }
+    
+    /** Orbit around `look`.
+     
+     - Parameters:
+        - parameter dx: Horizontal drag in fractions of the window width.
+        - parameter dy: Vertical drag in fractions of the window height.
+     */
+    void orbit(const float dx, const float dy) {
+        theta -= dx * PI; // related with y-axis rotation
+        phi -= dy * PI;   // related with x-axis rotation
+        phi = comp::clamp(phi, -PI / 2 + 0.01f, PI / 2 - 0.01f);
+        rotatePosition();
+        input.dx += dx;
+        input.dy += dy;
+    }
+    
+    void zoom(const float scrollOffset) {
+        // Y Offset - FOVY Modification
+        fovy -= scrollOffset / 10;
+        fovy = comp::clamp(fovy, 0.01f, 180.f-0.01f);
+        input.scroll += scrollOffset;
     }
     
-    glm::mat4 perspective(float aspect, float zNear, float zFar) {
-        return glm::perspective(fovy * PI / 180.f, aspect, zNear, zFar);
+    /** Record a click at window coordinates(x, y), for `takeInput`.*/
+    void click(const double x, const double y) {
+        input.clicked = true;
+        input.clickX = x;
+        input.clickY = y;
     }
     
+    /** World-space ray through window coordinates(x, y), e.g. the cursor, for picking.
+     
+     Unprojects through the current `lookAt` and `perspective`, so pass the near and far planes used for drawing. The ray starts on the near plane and its direction is unit length.
+     
+     - Parameters:
+        - parameter width: Window width in the units of x(glfw window size, not framebuffer size).
+        - parameter height: Window height in the units of y.
+     */
+    Ray cursorRay(const double x, const double y, const int width, const int height, const float zNear, const float zFar) {
+        glm::mat4 inverseViewProjection = glm::inverse(perspective(float(width) / float(height), zNear, zFar) * lookAt());
+        // Window y grows downward, normalized device y upward.
+        float ndcX = float(2 * x / width - 1), ndcY = float(1 - 2 * y / height);
+        glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, -1, 1);
+        glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, 1, 1);
+        glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+        return {origin, glm::normalize(glm::vec3(farPoint) / farPoint.w - origin)};
+    }
+    
+    /** Input applied since the last call.*/
+    CameraInput takeInput() {
+        CameraInput taken = input;
+        input = CameraInput();
+        return taken;
+    }
+    
+    /** Set false to ignore the glfw callbacks, e.g. while replaying a recorded path.*/
+    bool inputEnabled = true;
+    
     void glfwSetCallbacks(GLFWwindow* window) {
         glfwSetCursorPosCallback(window, cursorPosCallback);
         glfwSetScrollCallback(window, scrollCallback);
+        glfwSetMouseButtonCallback(window, mouseButtonCallback);
     }
     
     glm::vec3 getCurPosition() {
         return curPosition;
     }
+    
+private:
+    CameraInput input;
 };
 
 Camera camera;
 
-namespace comp {
-float min(const float &a, const float &b) {
-    return a > b ? b : a;
-}
-float max(const float &a, const float &b) {
-    return a > b ? a : b;
-}
-float clamp(const float &value, const float &left, const float &right) {
-    return max(left, min(value, right));
-}
-}
-
 void cursorPosCallback(GLFWwindow *window, double xpos, double ypos)
 {
     static double lastX = 0;
     static double lastY = 0;
     // when left mouse button clicked
-    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_1))
+    if (camera.inputEnabled && glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_1))
     {
         double dx = xpos - lastX;
         double dy = ypos - lastY;
         int w, h;
         glfwGetWindowSize(window, &w, &h);
-        camera.theta -= dx / w * PI; // related with y-axis rotation
-        camera.phi -= dy / h * PI;   // related with x-axis rotation
-        camera.phi = comp::clamp(camera.phi, -PI / 2 + 0.01f, PI / 2 - 0.01f);
-        
-        camera.rotatePosition();
+        camera.orbit(dx / w, dy / h);
     }
     // whenever, save current cursor position as previous one
     lastX = xpos;
@@ -108,9 +206,24 @@ void cursorPosCallback(GLFWwindow *window, double xpos, double ypos)
 
 void scrollCallback(GLFWwindow *window, double xoffset, double yoffset)
 {
-    // Y Offset - FOVY Modification
-    camera.fovy -= yoffset / 10;
-    camera.fovy = comp::clamp(camera.fovy, 0.01f, 180.f-0.01f);
+    if (camera.inputEnabled)
+        camera.zoom(yoffset);
+}
+
+void mouseButtonCallback(GLFWwindow *window, int button, int action, int mods)
+{
+    static double pressX = 0;
+    static double pressY = 0;
+    if (!camera.inputEnabled || button != GLFW_MOUSE_BUTTON_1) return;
+    double x, y;
+    glfwGetCursorPos(window, &x, &y);
+    if (action == GLFW_PRESS) {
+        pressX = x;
+        pressY = y;
+    } else if (action == GLFW_RELEASE && std::abs(x - pressX) + std::abs(y - pressY) < 4) {
+        // A drag orbits; only a press and release in place is a click.
+        camera.click(x, y);
+    }
 }
 
 #endif
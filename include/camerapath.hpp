@@ -0,0 +1,314 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <YGLWindow.hpp>
+#include <camera.hpp>
+#include <gputimer.hpp>
+#include <timing.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/** Camera state and the input that led to it, for one fixed step.*/
+struct CameraSample {
+    glm::vec3 initPosition = glm::vec3(0, 0, 10);
+    glm::vec3 look = glm::vec3(0);
+    glm::vec3 up = glm::vec3(0, 1, 0);
+    float theta = 0;
+    float phi = 0;
+    float fovy = 45.f;
+    CameraInput input;
+};
+
+/** Camera states recorded at a fixed rate, replayed one sample per frame.
+
+ Replay does not depend on real time or real input, so every run renders the same frames.
+
+ ```
+ // Recording: one sample per fixed update step.
+ window.updateFunc([&](double) { path.record(camera); }, path.hz);
+ ...
+ path.save("orbit.campath");
+ ```
+ */
+struct CameraPath {
+    /** Rate the samples were recorded at.*/
+    double hz = 60;
+    std::vector<CameraSample> samples;
+
+    size_t size() const { return samples.size(); }
+
+    /** Append the current camera state and the input taken from it since the last sample.*/
+    void record(Camera &camera) {
+        CameraSample s;
+        s.initPosition = camera.initPosition;
+        s.look = camera.look;
+        s.up = camera.up;
+        s.theta = camera.theta;
+        s.phi = camera.phi;
+        s.fovy = camera.fovy;
+        s.input = camera.takeInput();
+        samples.push_back(s);
+    }
+
+    /** Put the camera in the state of sample `i`.
+
+     - Parameters:
+        - parameter fromInput: Re-apply the recorded input on top of the previous state instead of restoring the recorded state. Only sample 0 is restored. Use it to replay input handling itself; it must be applied to consecutive samples.
+     */
+    void apply(Camera &camera, const size_t i, const bool fromInput = false) const {
+        const CameraSample &s = samples[i];
+        if (fromInput && i > 0) {
+            if (s.input.dx != 0 || s.input.dy != 0) camera.orbit(s.input.dx, s.input.dy);
+            if (s.input.scroll != 0) camera.zoom(s.input.scroll);
+            camera.takeInput();
+            return;
+        }
+        camera.initPosition = s.initPosition;
+        camera.look = s.look;
+        camera.up = s.up;
+        camera.theta = s.theta;
+        camera.phi = s.phi;
+        camera.fovy = s.fovy;
+        camera.rotatePosition();
+    }
+
+    /** Write as text, one sample per line. Floats are written with enough digits to read back exactly.
+
+     Version 2 of the format adds the click of each sample; `load` reads version 1 files as having no clicks.
+     */
+    bool save(const std::string &filename) const {
+        std::ofstream file(filename);
+        if (!file.is_open()) {
+            std::cerr << filename << " File Not Opened" << std::endl;
+            return false;
+        }
+        file.precision(std::numeric_limits<float>::max_digits10);
+        file << "campath 2 " << hz << ' ' << samples.size() << '\n';
+        for (auto &s : samples) {
+            file << s.initPosition.x << ' ' << s.initPosition.y << ' ' << s.initPosition.z << ' '
+                 << s.look.x << ' ' << s.look.y << ' ' << s.look.z << ' '
+                 << s.up.x << ' ' << s.up.y << ' ' << s.up.z << ' '
+                 << s.theta << ' ' << s.phi << ' ' << s.fovy << ' '
+                 << s.input.dx << ' ' << s.input.dy << ' ' << s.input.scroll << ' ';
+            // Click positions are doubles.
+            file.precision(std::numeric_limits<double>::max_digits10);
+            file << s.input.clicked << ' ' << s.input.clickX << ' ' << s.input.clickY << '\n';
+            file.precision(std::numeric_limits<float>::max_digits10);
+        }
+        return bool(file);
+    }
+
+    bool load(const std::string &filename) {
+        std::fstream file(filename);
+        if (!file.is_open()) {
+            std::cerr << filename << " File Not Found" << std::endl;
+            return false;
+        }
+        std::string magic;
+        int version = 0;
+        size_t n = 0;
+        file >> magic >> version >> hz >> n;
+        if (magic != "campath" || version < 1 || version > 2) {
+            std::cerr << filename << " is not a camera path" << std::endl;
+            return false;
+        }
+        samples.resize(n);
+        for (auto &s : samples) {
+            file >> s.initPosition.x >> s.initPosition.y >> s.initPosition.z
+                 >> s.look.x >> s.look.y >> s.look.z
+                 >> s.up.x >> s.up.y >> s.up.z
+                 >> s.theta >> s.phi >> s.fovy
+                 >> s.input.dx >> s.input.dy >> s.input.scroll;
+            // Version 1 has no clicks.
+            s.input.clicked = false;
+            s.input.clickX = s.input.clickY = 0;
+            if (version >= 2) file >> s.input.clicked >> s.input.clickX >> s.input.clickY;
+        }
+        if (!file) {
+            std::cerr << filename << " is truncated" << std::endl;
+            samples.clear();
+            return false;
+        }
+        return true;
+    }
+};
+
+/** Per-frame timings of one replay of a camera path.*/
+struct PathReport {
+    std::string name;
+    /** CPU time of the render function, per frame.*/
+    std::vector<double> cpuMs;
+    /** Time between the starts of consecutive frames, per frame(0 for the first).*/
+    std::vector<double> frameMs;
+    /** GPU time of the render function. Results arrive late, so only the summary is kept.*/
+    FrameStats gpu;
+
+    FrameStats cpu() const { return summarize(cpuMs, 0); }
+    FrameStats frame() const { return summarize(frameMs, 1); }
+
+    static FrameStats summarize(const std::vector<double> &times, const size_t skip) {
+        if (times.size() <= skip) return FrameStats();
+        FrameTimeHistory history(times.size() - skip);
+        for (size_t i = skip; i < times.size(); i++) history.push(times[i]);
+        return history.stats();
+    }
+
+    void print() const {
+        auto line = [](const char *label, const FrameStats &s) {
+            std::printf("  %-6s n=%5d mean %8.3f  p50 %8.3f  p90 %8.3f  p99 %8.3f  max %8.3f ms\n",
+                        label, s.count, s.mean, s.p50, s.p90, s.p99, s.max);
+        };
+        std::printf("%s\n", name.c_str());
+        line("cpu", cpu());
+        line("frame", frame());
+        line("gpu", gpu);
+    }
+
+    /** Write per-frame times as CSV(`frame,cpu_ms,frame_ms`), for diffing runs frame by frame.*/
+    bool writeCSV(const std::string &filename) const {
+        std::ofstream file(filename);
+        if (!file.is_open()) {
+            std::cerr << filename << " File Not Opened" << std::endl;
+            return false;
+        }
+        file << "frame,cpu_ms,frame_ms\n";
+        for (size_t i = 0; i < cpuMs.size(); i++)
+            file << i << ',' << cpuMs[i] << ',' << frameMs[i] << '\n';
+        return bool(file);
+    }
+
+    /** Read per-frame times written by `writeCSV`.
+
+     - Returns: false, with no frames, when the file is missing, empty or has a malformed row.
+     */
+    bool loadCSV(const std::string &filename) {
+        std::fstream file(filename);
+        if (!file.is_open()) {
+            std::cerr << filename << " File Not Found" << std::endl;
+            return false;
+        }
+        cpuMs.clear();
+        frameMs.clear();
+        std::string line;
+        if (!std::getline(file, line) || line.compare(0, 22, "frame,cpu_ms,frame_ms") != 0) {
+            std::cerr << filename << " is not a frame time CSV" << std::endl;
+            return false;
+        }
+        while (std::getline(file, line)) {
+            if (line.empty() || line == "\r") continue;
+            std::istringstream row(line);
+            size_t frame;
+            double cpu, interval;
+            char comma1, comma2;
+            if (!(row >> frame >> comma1 >> cpu >> comma2 >> interval) || comma1 != ',' || comma2 != ',' ||
+                frame != cpuMs.size()) {
+                std::cerr << filename << " has a malformed row: " << line << std::endl;
+                cpuMs.clear();
+                frameMs.clear();
+                return false;
+            }
+            cpuMs.push_back(cpu);
+            frameMs.push_back(interval);
+        }
+        if (cpuMs.empty()) {
+            std::cerr << filename << " has no frames" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /** Print percentile changes against `baseline` and the frames that regressed the most.
+
+     - Parameters:
+        - parameter worst: Number of frames to list.
+     */
+    void compare(const PathReport &baseline, const int worst = 5) const {
+        FrameStats a = baseline.cpu(), b = cpu();
+        auto delta = [](const char *label, const double before, const double after) {
+            std::printf("  %-4s %8.3f -> %8.3f ms (%+.1f%%)\n", label, before, after,
+                        before > 0 ? (after - before) / before * 100 : 0.0);
+        };
+        std::printf("%s: cpu vs baseline\n", name.c_str());
+        delta("mean", a.mean, b.mean);
+        delta("p50", a.p50, b.p50);
+        delta("p90", a.p90, b.p90);
+        delta("p99", a.p99, b.p99);
+        delta("max", a.max, b.max);
+
+        // Same path, so frame i shows the same view in both runs.
+        size_t n = std::min(cpuMs.size(), baseline.cpuMs.size());
+        std::vector<size_t> frames(n);
+        for (size_t i = 0; i < n; i++) frames[i] = i;
+        auto regression = [&](size_t i) { return cpuMs[i] - baseline.cpuMs[i]; };
+        size_t k = std::min(n, size_t(std::max(worst, 0)));
+        std::partial_sort(frames.begin(), frames.begin() + k, frames.end(),
+                          [&](size_t x, size_t y) { return regression(x) > regression(y); });
+        for (size_t j = 0; j < k; j++)
+            std::printf("  frame %5zu %8.3f -> %8.3f ms\n", frames[j], baseline.cpuMs[frames[j]], cpuMs[frames[j]]);
+    }
+};
+
+/** Render every sample of `path` once, one frame each, and time the frames.
+
+ Sets the window's frame limit to the path's length for the run, and suspends camera input and the window's update function, so recording is not running during the replay. All three are restored afterwards; `render` is left as the window's render function. `mainLoop` calls the window's init function again. Pair with `swapMode(SwapMode::Uncapped)` or a headless window so vsync does not hide the frame cost.
+
+ - Parameters:
+    - parameter render: Draws one frame with the current `camera`.
+    - parameter fromInput: See `CameraPath::apply`.
+ */
+inline PathReport runCameraPath(YGLWindow &window, const CameraPath &path, Camera &camera,
+                                YGLWindow::YGLFunc render, const std::string &name = "",
+                                const bool fromInput = false) {
+    PathReport report;
+    report.name = name;
+    report.cpuMs.reserve(path.size());
+    report.frameMs.reserve(path.size());
+
+    GPUTimer timer;
+    timer.init();
+    std::vector<double> gpuMs;
+    gpuMs.reserve(path.size());
+
+    bool inputEnabled = camera.inputEnabled;
+    camera.inputEnabled = false;
+    // An update function recording into a path(`CameraPath::record`) would record the replay.
+    YGLWindow::YGLUpdateFunc update = window.getUpdateFunc();
+    const double updateHz = window.getUpdateHz();
+    window.updateFunc(nullptr, updateHz);
+    timing::Clock::time_point previous;
+
+    const int maxFrames = window.maxFrames();
+    window.maxFrames(int(path.size()));
+    window.renderFunc([&]() {
+        auto start = timing::Clock::now();
+        report.frameMs.push_back(report.frameMs.empty() ? 0 : timing::milliseconds(start - previous));
+        previous = start;
+
+        path.apply(camera, size_t(window.frameCount()), fromInput);
+        timer.begin();
+        render();
+        timer.end();
+        timer.poll(gpuMs);
+
+        report.cpuMs.push_back(timing::milliseconds(timing::Clock::now() - start));
+    });
+    window.mainLoop();
+
+    glFinish();
+    timer.poll(gpuMs);
+    report.gpu = PathReport::summarize(gpuMs, 0);
+
+    window.renderFunc(render);
+    window.updateFunc(update, updateHz);
+    window.maxFrames(maxFrames);
+    camera.inputEnabled = inputEnabled;
+    return report;
+}
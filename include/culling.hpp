@@ -0,0 +1,354 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <bounds.hpp>
+#include <objreader.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define YGL_CULL_SSE
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h> // _BitScanForward
+#endif
+
+/** Bounds of an object in world space, from its loaded bounds and model matrix.*/
+inline AABB worldBounds(const ObjData &obj, const glm::mat4 &model) {
+    return AABB(obj.minPos, obj.maxPos).transformed(model);
+}
+
+inline AABB worldBounds(const ObjData::Submesh &submesh, const glm::mat4 &model) {
+    return AABB(submesh.minPos, submesh.maxPos).transformed(model);
+}
+
+/** Six planes of a view frustum. Normals point inward.*/
+struct Frustum {
+    glm::vec4 planes[6];
+
+    /** Extract planes from projection * view(Gribb-Hartmann), for OpenGL's -1..1 clip depth.*/
+    static Frustum fromMatrix(const glm::mat4 &viewProj) {
+        auto row = [&](const int i) {
+            return glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+        };
+        Frustum f;
+        f.planes[0] = row(3) + row(0); // left
+        f.planes[1] = row(3) - row(0); // right
+        f.planes[2] = row(3) + row(1); // bottom
+        f.planes[3] = row(3) - row(1); // top
+        f.planes[4] = row(3) + row(2); // near
+        f.planes[5] = row(3) - row(2); // far
+        for (auto &p : f.planes)
+            p /= glm::length(glm::vec3(p));
+        return f;
+    }
+
+    bool intersects(const AABB &box) const {
+        glm::vec3 c = box.center(), e = box.extent();
+        for (auto &p : planes) {
+            float d = p.x * c.x + p.y * c.y + p.z * c.z + p.w;
+            float r = std::abs(p.x) * e.x + std::abs(p.y) * e.y + std::abs(p.z) * e.z;
+            if (d + r < 0) return false;
+        }
+        return true;
+    }
+};
+
+namespace culling {
+
+/** Boxes in center/extent structure-of-arrays form, padded so 4 and 8 wide loads never run off the end.*/
+struct BoxesSoA {
+    std::vector<float> cx, cy, cz, ex, ey, ez;
+    size_t count = 0;
+
+    void resize(const size_t n) {
+        count = n;
+        size_t padded = (n + 7) / 8 * 8 + 4;
+        for (auto *v : {&cx, &cy, &cz, &ex, &ey, &ez}) v->assign(padded, 0.f);
+        // Padding boxes sit far outside any frustum.
+        for (size_t i = n; i < padded; i++) cx[i] = cy[i] = cz[i] = 1e30f;
+    }
+
+    void set(const size_t i, const AABB &box) {
+        glm::vec3 c = box.center(), e = box.extent();
+        cx[i] = c.x; cy[i] = c.y; cz[i] = c.z;
+        ex[i] = e.x; ey[i] = e.y; ez[i] = e.z;
+    }
+};
+
+/** Test 4 boxes, given by pointers to their first element in each SoA array, against the frustum.
+
+ - Parameters:
+    - parameter inside: Bit k set when box k is entirely inside.
+ - Returns: Bit k set when box k intersects the frustum.
+ */
+inline int test4(const Frustum &f,
+                 const float *cx, const float *cy, const float *cz,
+                 const float *ex, const float *ey, const float *ez,
+                 int &inside) {
+#ifdef YGL_CULL_SSE
+    __m128 vcx = _mm_loadu_ps(cx), vcy = _mm_loadu_ps(cy), vcz = _mm_loadu_ps(cz);
+    __m128 vex = _mm_loadu_ps(ex), vey = _mm_loadu_ps(ey), vez = _mm_loadu_ps(ez);
+    __m128 outside = _mm_setzero_ps(), partial = _mm_setzero_ps();
+    const __m128 zero = _mm_setzero_ps();
+    for (auto &p : f.planes) {
+        __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vcx, _mm_set1_ps(p.x)),
+                                         _mm_mul_ps(vcy, _mm_set1_ps(p.y))),
+                              _mm_add_ps(_mm_mul_ps(vcz, _mm_set1_ps(p.z)), _mm_set1_ps(p.w)));
+        __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vex, _mm_set1_ps(std::abs(p.x))),
+                                         _mm_mul_ps(vey, _mm_set1_ps(std::abs(p.y)))),
+                              _mm_mul_ps(vez, _mm_set1_ps(std::abs(p.z))));
+        outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+        partial = _mm_or_ps(partial, _mm_cmplt_ps(_mm_sub_ps(d, r), zero));
+    }
+    int out = _mm_movemask_ps(outside);
+    inside = ~(out | _mm_movemask_ps(partial)) & 0xF;
+    return ~out & 0xF;
+#else
+    int out = 0, part = 0;
+    for (auto &p : f.planes) {
+        for (int k = 0; k < 4; k++) {
+            float d = cx[k] * p.x + cy[k] * p.y + cz[k] * p.z + p.w;
+            float r = ex[k] * std::abs(p.x) + ey[k] * std::abs(p.y) + ez[k] * std::abs(p.z);
+            if (d + r < 0) out |= 1 << k;
+            if (d - r < 0) part |= 1 << k;
+        }
+    }
+    inside = ~(out | part) & 0xF;
+    return ~out & 0xF;
+#endif
+}
+
+/** Test boxes i..i+7. Returns bit k set when box i+k intersects.*/
+inline int test8(const Frustum &f, const BoxesSoA &b, const size_t i) {
+#ifdef __AVX__
+    __m256 vcx = _mm256_loadu_ps(&b.cx[i]), vcy = _mm256_loadu_ps(&b.cy[i]), vcz = _mm256_loadu_ps(&b.cz[i]);
+    __m256 vex = _mm256_loadu_ps(&b.ex[i]), vey = _mm256_loadu_ps(&b.ey[i]), vez = _mm256_loadu_ps(&b.ez[i]);
+    __m256 outside = _mm256_setzero_ps();
+    for (auto &p : f.planes) {
+        __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vcx, _mm256_set1_ps(p.x)),
+                                               _mm256_mul_ps(vcy, _mm256_set1_ps(p.y))),
+                                 _mm256_add_ps(_mm256_mul_ps(vcz, _mm256_set1_ps(p.z)), _mm256_set1_ps(p.w)));
+        __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vex, _mm256_set1_ps(std::abs(p.x))),
+                                               _mm256_mul_ps(vey, _mm256_set1_ps(std::abs(p.y)))),
+                                 _mm256_mul_ps(vez, _mm256_set1_ps(std::abs(p.z))));
+        outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(d, r), _mm256_setzero_ps(), _CMP_LT_OQ));
+    }
+    return ~_mm256_movemask_ps(outside) & 0xFF;
+#else
+    int inside;
+    int lo = test4(f, &b.cx[i], &b.cy[i], &b.cz[i], &b.ex[i], &b.ey[i], &b.ez[i], inside);
+    int hi = test4(f, &b.cx[i + 4], &b.cy[i + 4], &b.cz[i + 4], &b.ex[i + 4], &b.ey[i + 4], &b.ez[i + 4], inside);
+    return lo | hi << 4;
+#endif
+}
+
+/** Index of the lowest set bit of a nonzero mask.*/
+inline int lowestBit(const int mask) {
+#ifdef _MSC_VER
+    unsigned long k;
+    _BitScanForward(&k, unsigned(mask));
+    return int(k);
+#else
+    return __builtin_ctz(unsigned(mask));
+#endif
+}
+
+/** Brute force: test every box, 8 at a time. Appends indices of intersecting boxes to `visible`.*/
+inline void cullBoxes(const Frustum &f, const BoxesSoA &boxes, std::vector<uint32_t> &visible) {
+    for (size_t i = 0; i < boxes.count; i += 8) {
+        int mask = test8(f, boxes, i);
+        while (mask) {
+            int k = lowestBit(mask);
+            mask &= mask - 1;
+            if (i + k < boxes.count) visible.push_back(uint32_t(i + k));
+        }
+    }
+}
+}
+
+/** 4-wide BVH over object bounds for frustum culling.
+
+ Each node keeps its 4 children's boxes in SoA form, so visiting a node is a single 4-box SIMD test. Subtrees found entirely inside the frustum are emitted without further tests, and objects of a partially visible leaf are tested 4 at a time.
+
+ Moving objects: `setBounds` then `refit`, which recomputes only the nodes above changed objects. Rebuild with `build` when objects moved far enough for the tree to get loose.
+ */
+struct SceneBVH {
+    /** Objects per leaf slot.*/
+    static constexpr int leafSize = 4;
+
+    struct Node {
+        float cx[4], cy[4], cz[4], ex[4], ey[4], ez[4];
+        /** Child node index, or -1 when the slot is a leaf(or empty).*/
+        int32_t child[4];
+        /** Objects under each slot: range [first, first + count) of `order`.*/
+        uint32_t first[4], count[4];
+        int32_t parent;
+        bool dirty;
+    };
+
+    std::vector<Node> nodes;
+    /** Object indices in BVH order.*/
+    std::vector<uint32_t> order;
+
+    void build(const std::vector<AABB> &bounds) {
+        this->bounds = bounds;
+        nodes.clear();
+        order.resize(bounds.size());
+        for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+        centroids.resize(bounds.size());
+        for (size_t i = 0; i < bounds.size(); i++) centroids[i] = bounds[i].center();
+
+        objectSlot.assign(bounds.size(), -1);
+        if (!bounds.empty()) buildNode(0, uint32_t(bounds.size()), -1);
+
+        position.resize(order.size());
+        objects.resize(order.size());
+        for (uint32_t k = 0; k < order.size(); k++) {
+            position[order[k]] = k;
+            objects.set(k, bounds[order[k]]);
+        }
+    }
+
+    /** Update an object's world bounds. Takes effect at the next `refit`.*/
+    void setBounds(const uint32_t object, const AABB &box) {
+        bounds[object] = box;
+        objects.set(position[object], box);
+        for (int32_t n = objectSlot[object]; n >= 0 && !nodes[n].dirty; n = nodes[n].parent)
+            nodes[n].dirty = true;
+    }
+
+    /** Recompute the boxes of nodes above objects changed by `setBounds`, bottom-up.*/
+    void refit() {
+        // Children always come after their parent, so reverse order is bottom-up.
+        for (int32_t n = int32_t(nodes.size()) - 1; n >= 0; n--) {
+            Node &node = nodes[n];
+            if (!node.dirty) continue;
+            for (int s = 0; s < 4; s++) {
+                if (node.count[s] == 0) continue;
+                setSlot(node, s, node.child[s] >= 0 ? nodeBounds(nodes[node.child[s]]) : rangeBounds(node.first[s], node.count[s]));
+            }
+            node.dirty = false;
+        }
+    }
+
+    /** Fill `visible` with the indices of objects intersecting the frustum.*/
+    void cull(const Frustum &f, std::vector<uint32_t> &visible) const {
+        visible.clear();
+        if (nodes.empty()) return;
+
+        int32_t stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node &node = nodes[stack[--top]];
+            int inside;
+            int mask = culling::test4(f, node.cx, node.cy, node.cz, node.ex, node.ey, node.ez, inside);
+            for (int s = 0; s < 4; s++) {
+                if (!(mask >> s & 1) || node.count[s] == 0) continue;
+                if (inside >> s & 1) {
+                    visible.insert(visible.end(), order.begin() + node.first[s], order.begin() + node.first[s] + node.count[s]);
+                } else if (node.child[s] >= 0) {
+                    stack[top++] = node.child[s];
+                } else {
+                    cullLeaf(f, node.first[s], node.count[s], visible);
+                }
+            }
+        }
+    }
+
+private:
+    int32_t buildNode(const uint32_t first, const uint32_t count, const int32_t parent) {
+        int32_t index = int32_t(nodes.size());
+        nodes.emplace_back();
+        nodes[index].parent = parent;
+        nodes[index].dirty = false;
+
+        // A median split along the longest centroid axis, then one more in each half, gives 4 groups.
+        uint32_t split[5] = {first, 0, first + count / 2, 0, first + count};
+        split[1] = split[0] + (split[2] - split[0]) / 2;
+        split[3] = split[2] + (split[4] - split[2]) / 2;
+        splitMedian(split[0], split[4] - split[0]);
+        splitMedian(split[0], split[2] - split[0]);
+        splitMedian(split[2], split[4] - split[2]);
+        if (count <= leafSize * 4) {
+            // Small enough: slots become leaves directly, no further nodes.
+            for (int s = 0; s <= 4; s++) split[s] = std::min(first + s * leafSize, first + count);
+        }
+
+        for (int s = 0; s < 4; s++) {
+            uint32_t f = split[s], c = split[s + 1] - split[s];
+            int32_t child = -1;
+            if (c > leafSize) child = buildNode(f, c, index);
+            else
+                for (uint32_t k = f; k < f + c; k++) objectSlot[order[k]] = index;
+
+            Node &node = nodes[index];
+            node.child[s] = child;
+            node.first[s] = f;
+            node.count[s] = c;
+            if (c == 0) {
+                node.cx[s] = node.cy[s] = node.cz[s] = 1e30f;
+                node.ex[s] = node.ey[s] = node.ez[s] = 0;
+            } else {
+                setSlot(node, s, child >= 0 ? nodeBounds(nodes[child]) : rangeBounds(f, c));
+            }
+        }
+        return index;
+    }
+
+    /** Partition order[first, first+count) around its median along the longest centroid axis.*/
+    void splitMedian(const uint32_t first, const uint32_t count) {
+        if (count < 2) return;
+        AABB c;
+        for (uint32_t k = first; k < first + count; k++) c.expand(centroids[order[k]]);
+        glm::vec3 size = c.max - c.min;
+        int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+        std::nth_element(order.begin() + first, order.begin() + first + count / 2, order.begin() + first + count,
+                         [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+    }
+
+    void cullLeaf(const Frustum &f, const uint32_t first, const uint32_t count, std::vector<uint32_t> &visible) const {
+        int inside;
+        int mask = culling::test4(f, &objects.cx[first], &objects.cy[first], &objects.cz[first],
+                                  &objects.ex[first], &objects.ey[first], &objects.ez[first], inside);
+        for (uint32_t k = 0; k < count; k++)
+            if (mask >> k & 1) visible.push_back(order[first + k]);
+    }
+
+    AABB rangeBounds(const uint32_t first, const uint32_t count) const {
+        AABB b;
+        for (uint32_t k = first; k < first + count; k++) b.expand(bounds[order[k]]);
+        return b;
+    }
+
+    static AABB nodeBounds(const Node &node) {
+        AABB b;
+        for (int s = 0; s < 4; s++) {
+            if (node.count[s] == 0) continue;
+            glm::vec3 c(node.cx[s], node.cy[s], node.cz[s]), e(node.ex[s], node.ey[s], node.ez[s]);
+            b.expand(AABB(c - e, c + e));
+        }
+        return b;
+    }
+
+    static void setSlot(Node &node, const int s, const AABB &box) {
+        glm::vec3 c = box.center(), e = box.extent();
+        node.cx[s] = c.x; node.cy[s] = c.y; node.cz[s] = c.z;
+        node.ex[s] = e.x; node.ey[s] = e.y; node.ez[s] = e.z;
+    }
+
+    std::vector<AABB> bounds;
+    std::vector<glm::vec3> centroids;
+    /** Object bounds in BVH order, for leaf tests.*/
+    culling::BoxesSoA objects;
+    /** Node whose leaf slot holds each object.*/
+    std::vector<int32_t> objectSlot;
+    /** Index of each object in `order`.*/
+    std::vector<uint32_t> position;
+};
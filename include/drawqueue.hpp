@@ -0,0 +1,141 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <glstats.hpp>
+#include <material.hpp>
+#include <objreader.hpp>
+#include <program.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/** Draws collected over a frame, then submitted in state order.
+
+ Each draw gets a 64-bit key: program(12 bits), material(16 bits), mesh(16 bits), depth(20 bits), most significant first. Sorting by key groups draws so each program is bound once, materials change only within a program, and each mesh's VAO is bound once per material; within a group draws go front to back, which helps early depth rejection.
+
+ ```
+ queue.clear();
+ for (...) queue.push(program, obj, model, obj.materialID(), distance);
+ queue.sort();
+ queue.submit(&table);
+ ```
+ Keys use the low bits of GL names, so two programs or meshes may share a key slot; that only makes the order less ideal, each draw still binds its own state.
+ */
+struct DrawQueue {
+    struct Item {
+        Program *program;
+        ObjData *mesh;
+        glm::mat4 model;
+        GLuint material;
+        /** Index range drawn. `count` 0 draws the whole mesh as loaded at submit time.*/
+        GLuint first;
+        GLuint count;
+        uint64_t key;
+    };
+
+    /** State changes made by the last `submit`.*/
+    struct Stats {
+        size_t draws = 0;
+        size_t programSwitches = 0;
+        size_t materialSwitches = 0;
+        size_t meshSwitches = 0;
+    };
+
+    /** Depth at which the depth bits of the key saturate.*/
+    float farDepth = 1000;
+    /** Model matrix uniform set for every draw.*/
+    const char *modelUniform = "model";
+
+    std::vector<Item> items;
+    Stats stats;
+
+    void clear() {
+        items.clear();
+        order.clear();
+    }
+
+    /** Queue a draw.
+
+     - Parameters:
+        - parameter model: Model matrix, set as `modelUniform`.
+        - parameter material: `MaterialTable` ID.
+        - parameter depth: Distance from the camera, for front to back order within a state group.
+     */
+    void push(Program &program, ObjData &mesh, const glm::mat4 &model, const GLuint material,
+              const float depth = 0, const GLuint first = 0, const GLuint count = 0) {
+        items.push_back({&program, &mesh, model, material, first, count,
+                         key(program.programID, material, mesh.vao, depth / farDepth)});
+    }
+
+    /** Sort key of a draw. `depth` is in [0, 1].*/
+    static uint64_t key(const GLuint program, const GLuint material, const GLuint mesh, const float depth) {
+        const uint64_t d = uint64_t(std::min(std::max(depth, 0.f), 1.f) * float((1 << 20) - 1));
+        return uint64_t(program & 0xFFF) << 52 | uint64_t(material & 0xFFFF) << 36 | uint64_t(mesh & 0xFFFF) << 20 | d;
+    }
+
+    /** Order draws by key. Draws with equal keys keep their push order.*/
+    void sort() {
+        order.resize(items.size());
+        for (size_t i = 0; i < items.size(); i++) order[i] = {items[i].key, uint32_t(i)};
+        // Ties on the key are broken by index, so a plain sort is stable.
+        std::sort(order.begin(), order.end(), [](const Sorted &a, const Sorted &b) {
+            return a.key != b.key ? a.key < b.key : a.index < b.index;
+        });
+    }
+
+    /** Issue the draws in sorted order(push order if `sort` was not called), binding only state that changes.
+
+     - Parameters:
+        - parameter materials: Table to bind, or nullptr if it is already bound.
+     */
+    void submit(MaterialTable *materials = nullptr) {
+        if (order.size() != items.size()) {
+            order.resize(items.size());
+            for (size_t i = 0; i < items.size(); i++) order[i] = {items[i].key, uint32_t(i)};
+        }
+        if (materials) materials->bind();
+
+        stats = Stats();
+        Program *program = nullptr;
+        ObjData *mesh = nullptr;
+        GLuint material = 0;
+        bool hasMaterial = false;
+        GLint modelLocation = -1;
+        for (const Sorted &s : order) {
+            const Item &item = items[s.index];
+            if (item.program != program) {
+                program = item.program;
+                program->use();
+                modelLocation = glGetUniformLocation(program->programID, modelUniform);
+                stats.programSwitches++;
+            }
+            if (!hasMaterial || item.material != material) {
+                material = item.material;
+                hasMaterial = true;
+                MaterialTable::setMaterial(material);
+                stats.materialSwitches++;
+            }
+            if (item.mesh != mesh) {
+                mesh = item.mesh;
+                mesh->bind();
+                stats.meshSwitches++;
+            }
+            glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(item.model));
+            YGL_GL_COUNT(uniformUpdates, 1);
+            mesh->draw(item.first, item.count ? item.count : mesh->nElements3 * 3);
+            stats.draws++;
+        }
+    }
+
+private:
+    struct Sorted {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    std::vector<Sorted> order;
+};
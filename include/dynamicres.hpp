@@ -0,0 +1,130 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <framebuffer.hpp>
+#include <gputimer.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/** Render the scene at a fraction of the window size, chosen from measured GPU time.
+
+ The framebuffer is allocated once for `maxScale` of the window, and lower scales only shrink its viewport. Every `adjustInterval` frames the median GPU time of the scene is compared to `targetMs` and the scale moves toward the value that should hit it(cost is taken as proportional to pixel count).
+
+ ```
+ dynres.init(window.width(), window.height());
+ ...
+ dynres.begin();
+ dynres.framebuffer.render(glfwWindow, draw);
+ dynres.end();       // upscale to the default framebuffer
+ ```
+ */
+struct DynamicResolution {
+    Framebuffer framebuffer;
+
+    float scale = 1;
+    float minScale = 0.5f;
+    float maxScale = 1;
+    /** GPU time budget of the scene in milliseconds.*/
+    double targetMs = 16.0;
+    /** GPU time samples taken before each scale change.*/
+    int adjustInterval = 8;
+
+    /** Allocate the scene framebuffer for a window of this size.
+
+     - Parameters:
+        - parameter colorFormat: Color attachment format(texture, so later passes can sample it).
+        - parameter depthFormat: Depth renderbuffer format.
+     */
+    void init(const int windowWidth, const int windowHeight,
+              const GLint colorFormat = GL_RGBA8, const GLenum depthFormat = GL_DEPTH24_STENCIL8) {
+        this->colorFormat = colorFormat;
+        this->depthFormat = depthFormat;
+        allocate(windowWidth, windowHeight);
+        timer.init();
+    }
+
+    /** Follow a window resize. Reallocates only if the window grew beyond the allocation.*/
+    void resize(const int windowWidth, const int windowHeight) {
+        int w = int(std::ceil(windowWidth * maxScale));
+        int h = int(std::ceil(windowHeight * maxScale));
+        if (w > framebuffer.width || h > framebuffer.height)
+            allocate(windowWidth, windowHeight);
+        else {
+            this->windowWidth = windowWidth;
+            this->windowHeight = windowHeight;
+        }
+        applyScale();
+    }
+
+    /** Start the frame: sets the framebuffer viewport for the current scale and starts GPU timing.*/
+    void begin() {
+        applyScale();
+        timer.begin();
+    }
+
+    /** End the frame: stops timing, upscales to the default framebuffer and updates the scale.*/
+    void end() {
+        timer.end();
+
+        // Bilinear blit. No shader or extra target, and the driver may use a dedicated scaler.
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer.id);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, Framebuffer::defaultID);
+        glBlitFramebuffer(0, 0, framebuffer.viewportWidth, framebuffer.viewportHeight,
+                          0, 0, windowWidth, windowHeight,
+                          GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, Framebuffer::defaultID);
+        glViewport(0, 0, windowWidth, windowHeight);
+
+        if (timer.poll(samples) > 0) lastGPUMs = samples.back();
+        if (int(samples.size()) >= adjustInterval) {
+            // Median, so one hitch(or a bogus first query) does not swing the scale.
+            std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+            adjust(samples[samples.size() / 2]);
+            samples.clear();
+        }
+    }
+
+    /** Multiply UVs by this to sample the rendered part of `framebuffer`'s textures.*/
+    glm::vec2 uvScale() const {
+        return glm::vec2(framebuffer.viewportWidth / float(framebuffer.width),
+                         framebuffer.viewportHeight / float(framebuffer.height));
+    }
+
+    double gpuMs() const { return lastGPUMs; }
+
+private:
+    void allocate(const int windowWidth, const int windowHeight) {
+        this->windowWidth = windowWidth;
+        this->windowHeight = windowHeight;
+        framebuffer.init(int(std::ceil(windowWidth * maxScale)), int(std::ceil(windowHeight * maxScale)));
+        framebuffer.attachTexture2D(1, colorFormat);
+        framebuffer.attachRenderBuffer(depthFormat);
+    }
+
+    void adjust(const double gpuMs) {
+        // Pixel count goes with scale^2. Move halfway toward the estimate to avoid oscillation.
+        float ideal = scale * float(std::sqrt(targetMs / std::max(gpuMs, 1e-3)));
+        float next = std::clamp(scale + (ideal - scale) * 0.5f, minScale, maxScale);
+        // Small changes only shift the image around.
+        if (std::abs(next - scale) > 0.02f) scale = next;
+    }
+
+    void applyScale() {
+        // Multiples of 8 keep the size stable between tiny scale changes.
+        int w = (int(windowWidth * scale) + 7) / 8 * 8;
+        int h = (int(windowHeight * scale) + 7) / 8 * 8;
+        framebuffer.setViewport(w, h);
+    }
+
+    GLint colorFormat = GL_RGBA8;
+    GLenum depthFormat = GL_DEPTH24_STENCIL8;
+    int windowWidth = 0, windowHeight = 0;
+
+    GPUTimer timer;
+    std::vector<double> samples;
+    double lastGPUMs = 0;
+};
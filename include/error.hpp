@@ -3,10 +3,221 @@
 
 #include <GL/glew.h>
 
+#include <algorithm>
+#include <cstdio>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/** GL error checks, debug output and object labels are compiled in when `YGL_GL_CHECKS` is 1.
+
+ Defaults to 1, or 0 when `NDEBUG` is defined. With 0, `glErr` and `glLabel` are empty functions and `GLDebug::enable` installs no callback, so release builds make no GL calls for them. Their arguments are still evaluated: a message or label built as a `std::string` is still built.
+ */
+#ifndef YGL_GL_CHECKS
+#ifdef NDEBUG
+#define YGL_GL_CHECKS 0
+#else
+#define YGL_GL_CHECKS 1
+#endif
+#endif
+
+/** Driver messages from `KHR_debug`(GL 4.3) or `ARB_debug_output`, reported as they arrive instead of polled with `glGetError`.
+
+ `glGetError` waits for the driver to catch up with the command stream on many implementations, so calling it after each GL call stalls the CPU. The debug callback gets the same errors, plus performance and portability warnings, without a round trip. Messages are filtered by severity and deduplicated: each distinct message is printed once, then again at 10, 100, 1000... repeats.
+
+ Debug output is per context: call `enable` with each context current. `YGLWindow` does this for its own contexts when checks are compiled in. Contexts without either extension(macOS stops at GL 4.1) keep the `glGetError` fallback in `glErr`.
+ */
+struct GLDebug {
+    static GLDebug &get() {
+        static GLDebug debug;
+        return debug;
+    }
+
+    /** Install the callback on the current context.
+
+     - Parameters:
+        - parameter minSeverity: Least severe message reported: `GL_DEBUG_SEVERITY_NOTIFICATION`, `_LOW`, `_MEDIUM` or `_HIGH`.
+        - parameter synchronous: Call back on the thread and inside the GL call that caused the message, so a breakpoint shows the culprit. Slower.
+     - Returns: false when the context has no debug output or checks are compiled out.
+     */
+    bool enable(const GLenum minSeverity = GL_DEBUG_SEVERITY_LOW, const bool synchronous = false) {
+#if YGL_GL_CHECKS
+        this->minSeverity = minSeverity;
+        if (GLEW_KHR_debug || GLEW_VERSION_4_3) {
+            glEnable(GL_DEBUG_OUTPUT);
+            if (synchronous) glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+            else glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+            glDebugMessageCallback(callback, this);
+            filter(glDebugMessageControl);
+            labels() = true;
+        } else if (GLEW_ARB_debug_output) {
+            if (synchronous) glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB);
+            else glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS_ARB);
+            glDebugMessageCallbackARB(callback, this);
+            filter(glDebugMessageControlARB);
+            labels() = false;
+        } else {
+            return false;
+        }
+        active() = true;
+        return true;
+#else
+        (void)minSeverity;
+        (void)synchronous;
+        return false;
+#endif
+    }
+
+    /** Remove the callback from the current context. `glErr` goes back to `glGetError`.*/
+    void disable() {
+#if YGL_GL_CHECKS
+        if (!active()) return;
+        if (labels()) {
+            glDebugMessageCallback(nullptr, nullptr);
+            glDisable(GL_DEBUG_OUTPUT);
+        } else {
+            glDebugMessageCallbackARB(nullptr, nullptr);
+        }
+        active() = false;
+        labels() = false;
+#endif
+    }
+
+    /** Whether the current thread's context reports through the callback.*/
+    static bool &active() {
+        static thread_local bool enabled = false;
+        return enabled;
+    }
+
+    /** Whether the current thread's context supports `glObjectLabel`(`KHR_debug` only).*/
+    static bool &labels() {
+        static thread_local bool enabled = false;
+        return enabled;
+    }
+
+    /** Distinct messages received so far.*/
+    size_t messageCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return messages.size();
+    }
+
+    /** Print every message that repeated, with its count.*/
+    void report(std::ostream &os = std::cerr) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto &entry : messages)
+            if (entry.second.count > 1)
+                os << "GL debug: " << entry.second.count << "x " << entry.second.text << std::endl;
+    }
+
+    /** Forget seen messages, so each is printed again on its next occurrence.*/
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        messages.clear();
+    }
+
+private:
+    struct Seen {
+        size_t count = 0;
+        std::string text;
+    };
+
+    GLDebug() = default;
+
+    static int rank(const GLenum severity) {
+        switch (severity) {
+            case GL_DEBUG_SEVERITY_HIGH:   return 3;
+            case GL_DEBUG_SEVERITY_MEDIUM: return 2;
+            case GL_DEBUG_SEVERITY_LOW:    return 1;
+            default:                       return 0;
+        }
+    }
+
+    /** Mute severities below `minSeverity` in the driver, so it does not even format them.*/
+    template <typename Control>
+    void filter(Control control) const {
+        const GLenum severities[] = {GL_DEBUG_SEVERITY_NOTIFICATION, GL_DEBUG_SEVERITY_LOW,
+                                     GL_DEBUG_SEVERITY_MEDIUM, GL_DEBUG_SEVERITY_HIGH};
+        for (GLenum s : severities)
+            control(GL_DONT_CARE, GL_DONT_CARE, s, 0, nullptr, rank(s) >= rank(minSeverity) ? GL_TRUE : GL_FALSE);
+    }
+
+    static const char *sourceName(const GLenum source) {
+        switch (source) {
+            case GL_DEBUG_SOURCE_API:             return "API";
+            case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   return "window system";
+            case GL_DEBUG_SOURCE_SHADER_COMPILER: return "shader compiler";
+            case GL_DEBUG_SOURCE_THIRD_PARTY:     return "third party";
+            case GL_DEBUG_SOURCE_APPLICATION:     return "application";
+            default:                              return "other";
+        }
+    }
+
+    static const char *typeName(const GLenum type) {
+        switch (type) {
+            case GL_DEBUG_TYPE_ERROR:               return "error";
+            case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+            case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "undefined behavior";
+            case GL_DEBUG_TYPE_PORTABILITY:         return "portability";
+            case GL_DEBUG_TYPE_PERFORMANCE:         return "performance";
+            case GL_DEBUG_TYPE_MARKER:              return "marker";
+            default:                                return "other";
+        }
+    }
+
+    static const char *severityName(const GLenum severity) {
+        switch (severity) {
+            case GL_DEBUG_SEVERITY_HIGH:   return "HIGH";
+            case GL_DEBUG_SEVERITY_MEDIUM: return "MEDIUM";
+            case GL_DEBUG_SEVERITY_LOW:    return "LOW";
+            default:                       return "NOTIFICATION";
+        }
+    }
+
+    static void APIENTRY callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                  GLsizei length, const GLchar *message, const void *user) {
+        GLDebug &self = *static_cast<GLDebug *>(const_cast<void *>(user));
+        if (rank(severity) < rank(self.minSeverity)) return;
+        self.receive(source, type, id, severity, length < 0 ? std::string(message) : std::string(message, size_t(length)));
+    }
+
+    void receive(const GLenum source, const GLenum type, const GLuint id, const GLenum severity, const std::string &message) {
+        // Drivers reuse ids across different messages, so the text is part of the key.
+        size_t key = std::hash<std::string>()(message) ^ (size_t(source) << 1) ^ (size_t(type) << 17) ^ (size_t(id) << 33);
+        size_t count;
+        std::string text;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Seen &seen = messages[key];
+            count = ++seen.count;
+            if (count == 1) {
+                char head[128];
+                std::snprintf(head, sizeof(head), "[%s] %s %s %u: ", severityName(severity), sourceName(source), typeName(type), id);
+                seen.text = head + message;
+            }
+            text = seen.text;
+        }
+        if (count == 1) {
+            std::cerr << "GL debug: " << text << std::endl;
+            return;
+        }
+        size_t power = 10;
+        while (power < count) power *= 10;
+        if (power == count) std::cerr << "GL debug: " << count << "x " << text << std::endl;
+    }
+
+    GLenum minSeverity = GL_DEBUG_SEVERITY_LOW;
+    mutable std::mutex mutex;
+    std::unordered_map<size_t, Seen> messages;
+};
+
+#if YGL_GL_CHECKS
 
 /** Get error log
- 
+
+ Polls `glGetError`, which can stall the CPU until the GPU catches up. Skipped when `GLDebug` is active on this thread's context, since the callback already reported the error.
+
  GL_INVALID_ENUM 0x0500
  GL_INVALID_VALUE 0x0501
  GL_INVALID_OPERATION 0x0502
@@ -14,7 +225,8 @@
  GL_STACK_UNDERFLOW 0x0504
  GL_OUT_OF_MEMORY 0x0505
  */
-void glErr(const std::string& message) {
+inline void glErr(const char *message) {
+    if (GLDebug::active()) return;
     GLint err = glGetError();
     if (err != GL_NO_ERROR) {
         std::string errType;
@@ -45,4 +257,29 @@ void glErr(const std::string& message) {
     }
 }
 
+inline void glErr(const std::string &message) {
+    glErr(message.c_str());
+}
+
+/** Name a GL object for debug messages and graphics debuggers(RenderDoc, apitrace).
+
+ - Parameters:
+    - parameter identifier: Object namespace: `GL_BUFFER`, `GL_TEXTURE`, `GL_PROGRAM`, `GL_FRAMEBUFFER`, `GL_VERTEX_ARRAY`, ...
+    - parameter name: The object, which must have been bound once.
+ */
+inline void glLabel(const GLenum identifier, const GLuint name, const std::string &label) {
+    if (name == 0 || !GLDebug::labels()) return;
+    // GL_MAX_LABEL_LENGTH is at least 256, including the terminator.
+    glObjectLabel(identifier, name, GLsizei(std::min<size_t>(label.size(), 255)), label.c_str());
+}
+
+#else
+
+// Empty functions rather than macros, so calls still type-check and names like `glErr` stay usable, e.g. as a function pointer.
+inline void glErr(const char *) {}
+inline void glErr(const std::string &) {}
+inline void glLabel(const GLenum, const GLuint, const std::string &) {}
+
+#endif
+
 #endif
@@ -15,8 +15,13 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 #include <error.hpp>
+#include <glstats.hpp>
+#include <gpumemory.hpp>
 
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <functional>
 using std::cerr;
 using std::endl;
 
@@ -32,19 +37,79 @@ struct TextureFormat {
      
      */
     GLenum type;
+    /** Size of a texel in video memory. Use it to pick the cheapest format that still fits the data.
+     */
+    int bytesPerPixel = 0;
     
     /** Generate texture format data by internalFormat
     
+     | internalFormat         | bytes | typical use                     |
+     |------------------------|-------|---------------------------------|
+     | GL_RGBA32F             | 16    | positions needing full float    |
+     | GL_RGBA16F             | 8     | HDR color                       |
+     | GL_RGB16F              | 6     | HDR color without alpha         |
+     | GL_R11F_G11F_B10F      | 4     | HDR color, lighting accumulation|
+     | GL_RGB10_A2            | 4     | normals, LDR color              |
+     | GL_RGBA8               | 4     | albedo                          |
+     | GL_RG16, GL_RG16_SNORM | 4     | encoded normals, motion vectors |
+     | GL_RG16F               | 4     | motion vectors                  |
+     | GL_RG8                 | 2     | small parameters                |
+     | GL_R32F                | 4     | linear depth                    |
+     | GL_R16F                | 2     | single channel HDR              |
+     | GL_R8                  | 1     | masks, roughness, AO            |
+     | GL_DEPTH_COMPONENT16   | 2     | depth                           |
+     | GL_DEPTH_COMPONENT24   | 4     | depth                           |
+     | GL_DEPTH_COMPONENT32F  | 4     | depth(reversed-Z)               |
+     | GL_DEPTH24_STENCIL8    | 4     | depth, stencil                  |
+     | GL_DEPTH32F_STENCIL8   | 8     | depth, stencil                  |
+     
      - Parameters:
         - parameter internalFormat: Split this into format and type value.
      */
     void generate(const GLint &internalFormat) {
         this->internalFormat = internalFormat;
-        if (internalFormat == GL_RGBA32F) {
-            this->format = GL_RGBA;
-            this->type = GL_FLOAT;
+        switch (internalFormat) {
+            case GL_RGBA32F:           set(GL_RGBA, GL_FLOAT, 16); break;
+            case GL_RGBA16F:           set(GL_RGBA, GL_HALF_FLOAT, 8); break;
+            case GL_RGB16F:            set(GL_RGB, GL_HALF_FLOAT, 6); break;
+            case GL_R11F_G11F_B10F:    set(GL_RGB, GL_UNSIGNED_INT_10F_11F_11F_REV, 4); break;
+            case GL_RGB10_A2:          set(GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, 4); break;
+            case GL_RGBA8:             set(GL_RGBA, GL_UNSIGNED_BYTE, 4); break;
+            case GL_RG16:              set(GL_RG, GL_UNSIGNED_SHORT, 4); break;
+            case GL_RG16_SNORM:        set(GL_RG, GL_SHORT, 4); break;
+            case GL_RG16F:             set(GL_RG, GL_HALF_FLOAT, 4); break;
+            case GL_RG8:               set(GL_RG, GL_UNSIGNED_BYTE, 2); break;
+            case GL_R32F:              set(GL_RED, GL_FLOAT, 4); break;
+            case GL_R16F:              set(GL_RED, GL_HALF_FLOAT, 2); break;
+            case GL_R8:                set(GL_RED, GL_UNSIGNED_BYTE, 1); break;
+            case GL_DEPTH_COMPONENT16: set(GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT, 2); break;
+            case GL_DEPTH_COMPONENT24: set(GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 4); break;
+            case GL_DEPTH_COMPONENT32F:set(GL_DEPTH_COMPONENT, GL_FLOAT, 4); break;
+            case GL_DEPTH24_STENCIL8:  set(GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 4); break;
+            case GL_DEPTH32F_STENCIL8: set(GL_DEPTH_STENCIL, GL_FLOAT_32_UNSIGNED_INT_24_8_REV, 8); break;
+            default:
+                cerr << "TextureFormat: unknown internalFormat " << internalFormat << endl;
+                break;
         }
     }
+    
+    bool isDepth() const {
+        return format == GL_DEPTH_COMPONENT || format == GL_DEPTH_STENCIL;
+    }
+    
+    /** Attachment point of this format. Color formats use `GL_COLOR_ATTACHMENT0 + colorIndex`.*/
+    GLenum attachment(const int colorIndex) const {
+        if (format == GL_DEPTH_COMPONENT) return GL_DEPTH_ATTACHMENT;
+        if (format == GL_DEPTH_STENCIL) return GL_DEPTH_STENCIL_ATTACHMENT;
+        return GL_COLOR_ATTACHMENT0 + colorIndex;
+    }
+    
+private:
+    void set(const GLenum format, const GLenum type, const int bytesPerPixel) {
+        this->format = format;
+        this->type = type;
+        this->bytesPerPixel = bytesPerPixel;
+    }
 };
 
 /** Framebuffer managing object.
@@ -53,12 +118,43 @@ struct Framebuffer {
     /** Framebuffer object's ID(handle)*/
     GLuint id = 0;
     int width = 0, height = 0;
+    /** Region rendered into, at most `width` x `height`. Shrinking it renders at a lower resolution without reallocating attachments.*/
+    int viewportWidth = 0, viewportHeight = 0;
     
     GLuint renderbuffer = 0;
     std::vector<GLuint> textureIDs = {};
     std::vector<GLuint> drawBufs = {};
     
+    /** Depth(-stencil) texture attached by `attachTexture2D` with a depth format.*/
+    GLuint depthTextureID = 0;
+    /** Color renderbuffers, e.g. multisampled attachments that are only ever resolved.*/
+    std::vector<GLuint> colorRenderbuffers = {};
+    
+    /** Empty vertex array of `renderFullscreen`, created on first use.*/
+    GLuint fullscreenVAO = 0;
+    
+    /** Samples per pixel of attachments created from now on. Greater than 1 makes multisampled attachments, which must be `resolve`d before sampling.*/
+    int samples = 1;
+    /** Bytes per pixel of all attachments together, samples included.*/
+    int bytesPerPixel = 0;
+    
     bool depthTest = true;
+    /** Lay down depth first with color writes off, then shade only the visible fragments with `GL_LEQUAL` and depth writes off. Needs `depthTest`.*/
+    bool depthPrepass = false;
+    
+    /** Framebuffer bound in place of the window's framebuffer(0), for the context current on this thread.
+     
+     A headless `YGLWindow` has no window framebuffer, so it points this at its offscreen target. Each thread has its own value, set by `YGLWindow::makeCurrent` along with the context, so windows rendering on different threads or taking turns on one do not draw into each other's targets.
+     */
+    static inline thread_local GLuint defaultID = 0;
+    
+    /** Vertex shader of `renderFullscreen`: one triangle covering the viewport, made from `gl_VertexID` alone.*/
+    static constexpr const char *fullscreenVS = R"(#version 410 core
+void main() {
+    vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
     
     /** Generate a new framebuffer object.
      
@@ -69,17 +165,21 @@ struct Framebuffer {
          - parameter h: **Height** of the framebuffer
      */
     void init(GLFWwindow *window) {
-        this->cleanup();
-        
         int w, h;
         glfwGetFramebufferSize(window, &w, &h);
+        this->init(w, h);
+    }
+    
+    void init(const int w, const int h) {
+        this->cleanup();
+        
         this->width = w;
         this->height = h;
+        this->viewportWidth = w;
+        this->viewportHeight = h;
         
+        // Completeness is checked once attachments exist, in attachTexture2D().
         glGenFramebuffers(1, &(this->id));
-        
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            cerr << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << endl;
     }
 
     /** Set a default framebuffer object.
@@ -91,12 +191,18 @@ struct Framebuffer {
          - parameter h: **Height** of the default framebuffer
      */
     void initDefault(GLFWwindow *window) {
-        this->cleanup();
-        
         int w, h;
         glfwGetFramebufferSize(window, &w, &h);
+        this->initDefault(w, h);
+    }
+    
+    void initDefault(const int w, const int h) {
+        this->cleanup();
+        
         this->width = w;
         this->height = h;
+        this->viewportWidth = w;
+        this->viewportHeight = h;
         
         this->id = 0;
     }
@@ -124,28 +230,54 @@ struct Framebuffer {
 
         this->bind();
         
+        glLabel(GL_FRAMEBUFFER, this->id, owner());
+        const GLenum target = samples > 1 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+        
         for (int i = 0; i < nTexture; i++) {
-            auto curidx = this->textureIDs.size();
-            this->textureIDs.push_back(-1);
-            glGenTextures(1, &this->textureIDs[curidx]);
-            glBindTexture(GL_TEXTURE_2D, this->textureIDs[curidx]);
-            glTexImage2D(GL_TEXTURE_2D,
-                         0,
-                         format.internalFormat,
-                         this->width,
-                         this->height,
-                         0,
-                         format.format,
-                         format.type,
-                         0);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            auto drawUnit = GL_COLOR_ATTACHMENT0 + int(curidx);
-            drawBufs.push_back(drawUnit);
+            GLuint texture;
+            glGenTextures(1, &texture);
+            glBindTexture(target, texture);
+            glLabel(GL_TEXTURE, texture,
+                    owner() + (format.isDepth() ? " depth" : " color " + std::to_string(textureIDs.size())));
+            if (samples > 1) {
+                glTexImage2DMultisample(target,
+                                        samples,
+                                        format.internalFormat,
+                                        width,
+                                        height,
+                                        GL_TRUE);
+            } else {
+                glTexImage2D(target,
+                             0,
+                             format.internalFormat,
+                             width,
+                             height,
+                             0,
+                             format.format,
+                             format.type,
+                             0);
+                glTexParameteri(target, GL_TEXTURE_MIN_FILTER, format.isDepth() ? GL_NEAREST : GL_LINEAR);
+                glTexParameteri(target, GL_TEXTURE_MAG_FILTER, format.isDepth() ? GL_NEAREST : GL_LINEAR);
+            }
+            bytesPerPixel += format.bytesPerPixel * samples;
+            GPUMemory::get().track(GPUMemory::Texture, texture,
+                                   size_t(width) * height * format.bytesPerPixel * samples, "framebuffer", owner());
+            
+            auto drawUnit = format.attachment(int(drawBufs.size()));
+            if (format.isDepth()) {
+                if (depthTextureID != 0) {
+                    GPUMemory::get().untrack(GPUMemory::Texture, depthTextureID);
+                    glDeleteTextures(1, &depthTextureID);
+                }
+                depthTextureID = texture;
+            } else {
+                textureIDs.push_back(texture);
+                drawBufs.push_back(drawUnit);
+            }
             glFramebufferTexture2D(GL_FRAMEBUFFER,
                                    drawUnit,
-                                   GL_TEXTURE_2D,
-                                   this->textureIDs[curidx],
+                                   target,
+                                   texture,
                                    0);
 //            GLint err = glGetError();
 //            if (err != GL_NO_ERROR) {
@@ -195,10 +327,6 @@ struct Framebuffer {
         tf.generate(internalFormat);
         
         this->attachTexture2D(nTexture, tf, width, height);
-        GLint err = glGetError();
-        if (err != GL_NO_ERROR) {
-           printf("%08X ", err);
-        }
         
         this->unbind();
     }
@@ -227,6 +355,8 @@ struct Framebuffer {
     #endif
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            GPUMemory::get().track(GPUMemory::Texture, textureIDs[tid], size_t(width) * height * 4, "texture", fileName);
+            glLabel(GL_TEXTURE, textureIDs[tid], fileName);
 
             stbi_image_free(data);
         } else {
@@ -234,92 +364,278 @@ struct Framebuffer {
             return -1;
         }
         glActiveTexture(GL_TEXTURE0 + tid);
+        YGL_GL_COUNT(textureBinds, 1);
         return tid;
     }
 
+    /** Generate a new renderbuffer and attach to this framebuffer.
+     
+     Renderbuffers cannot be sampled, which makes them the cheap choice for depth and for multisampled color that is only resolved.
+     
+     - Parameters:
+        - parameter internalFormat: Depth, depth-stencil or color format. See `TextureFormat::generate`.
+     */
     void attachRenderBuffer(const GLenum internalFormat) {
-        this->bind();
+        TextureFormat tf;
+        tf.generate(internalFormat);
         
-        glGenRenderbuffers(1, &(this->renderbuffer));
-        glBindRenderbuffer(GL_RENDERBUFFER, this->renderbuffer);
-        glRenderbufferStorage(GL_RENDERBUFFER,
-                              internalFormat,
-                              this->width,
-                              this->height);
+        this->bind();
+        glLabel(GL_FRAMEBUFFER, this->id, owner());
         
-        GLenum attachment;
-        if(internalFormat == GL_DEPTH24_STENCIL8)
-            attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+        GLuint rb;
+        glGenRenderbuffers(1, &rb);
+        glBindRenderbuffer(GL_RENDERBUFFER, rb);
+        glLabel(GL_RENDERBUFFER, rb,
+                owner() + (tf.isDepth() ? " depth" : " color " + std::to_string(colorRenderbuffers.size())));
+        if (samples > 1)
+            glRenderbufferStorageMultisample(GL_RENDERBUFFER,
+                                             samples,
+                                             internalFormat,
+                                             this->width,
+                                             this->height);
         else
-            return;
+            glRenderbufferStorage(GL_RENDERBUFFER,
+                                  internalFormat,
+                                  this->width,
+                                  this->height);
+        bytesPerPixel += tf.bytesPerPixel * samples;
+        GPUMemory::get().track(GPUMemory::Renderbuffer, rb,
+                               size_t(this->width) * this->height * tf.bytesPerPixel * samples, "framebuffer", owner());
+        
+        GLenum attachment = tf.attachment(int(drawBufs.size()));
+        if (tf.isDepth()) {
+            if (this->renderbuffer != 0) {
+                GPUMemory::get().untrack(GPUMemory::Renderbuffer, this->renderbuffer);
+                glDeleteRenderbuffers(1, &this->renderbuffer);
+            }
+            this->renderbuffer = rb;
+        } else {
+            colorRenderbuffers.push_back(rb);
+            drawBufs.push_back(attachment);
+            glDrawBuffers(int(drawBufs.size()), drawBufs.data());
+        }
         glFramebufferRenderbuffer(GL_FRAMEBUFFER,
                                   attachment,
                                   GL_RENDERBUFFER,
-                                  this->renderbuffer);
+                                  rb);
         
 
         glBindRenderbuffer(GL_RENDERBUFFER, 0);
         this->unbind();
     }
+    
+    /** Resolve this framebuffer into `target`.
+     
+     Multisampled attachments are averaged(color) or sample 0 is taken(depth) by `glBlitFramebuffer`. Each color attachment `i` goes to the target's color attachment `i`; a default framebuffer target only receives attachment 0.
+     
+     - Parameters:
+        - parameter target: Single-sampled framebuffer with the same viewport size.
+        - parameter mask: `GL_COLOR_BUFFER_BIT` and/or `GL_DEPTH_BUFFER_BIT`(with stencil if present).
+     */
+    void resolve(Framebuffer &target, const GLbitfield mask = GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT) {
+        const bool toDefault = target.id == 0;
+        // The window's framebuffer draws to GL_BACK, a headless target to its only color attachment.
+        const GLenum defaultBuf = defaultID == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0;
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, this->id);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, toDefault ? defaultID : target.id);
+        
+        if (mask & GL_COLOR_BUFFER_BIT) {
+            const int nColor = toDefault ? std::min(1, int(drawBufs.size())) : int(drawBufs.size());
+            for (int i = 0; i < nColor; i++) {
+                glReadBuffer(drawBufs[i]);
+                glDrawBuffer(toDefault ? defaultBuf : GL_COLOR_ATTACHMENT0 + i);
+                glBlitFramebuffer(0, 0, this->viewportWidth, this->viewportHeight,
+                                  0, 0, target.viewportWidth, target.viewportHeight,
+                                  GL_COLOR_BUFFER_BIT, GL_NEAREST);
+                YGL_GL_COUNT(blits, 1);
+            }
+            // Restore draw buffers changed above.
+            if (toDefault) glDrawBuffer(defaultBuf);
+            else glDrawBuffers(int(target.drawBufs.size()), target.drawBufs.data());
+            glReadBuffer(drawBufs.empty() ? GL_NONE : drawBufs[0]);
+        }
+        
+        GLbitfield depthMask = mask & (GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        if (depthMask) {
+            glBlitFramebuffer(0, 0, this->viewportWidth, this->viewportHeight,
+                              0, 0, target.viewportWidth, target.viewportHeight,
+                              depthMask, GL_NEAREST);
+            YGL_GL_COUNT(blits, 1);
+        }
+        YGL_GL_COUNT(framebufferBinds, 2);
+        glErr("Error on resolve()");
+        
+        this->unbind();
+    }
 
+    /** Owner tag of this framebuffer's attachments in `GPUMemory`.*/
+    std::string owner() const {
+        return "framebuffer " + std::to_string(this->id);
+    }
+    
+    /** Set the rendered region, clamped to the allocated size.*/
+    void setViewport(const int w, const int h) {
+        viewportWidth  = std::max(1, std::min(w, width));
+        viewportHeight = std::max(1, std::min(h, height));
+    }
+    
+    /** Clear, then draw an 8-vertex triangle strip from `vao`. Full-screen passes should use `renderFullscreen`, which needs no vertex data and no clear.*/
     void render(GLFWwindow* window, const GLuint vao) {
         this->bind();
     //    std::cout << "render id : " << this->id << std::endl;
         
-        glViewport(0, 0, this->width, this->height);
-        glClearColor(0, 0, 0, 0);
-        glClear(GL_COLOR_BUFFER_BIT);
+        setViewportAndClear(GL_COLOR_BUFFER_BIT);
         
         glBindVertexArray(vao);
         
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 8);
+        YGL_GL_COUNT(vertexArrayBinds, 1);
+        YGL_GL_COUNT(drawCalls, 1);
+        YGL_GL_COUNT(drawnVertices, 8);
+        
+        this->unbind();
+    }
+    
+    /** Draw one attributeless triangle over the viewport with the bound program, whose vertex shader is `fullscreenVS`.
+     
+     The triangle writes every pixel of the viewport, so there is no clear. Depth testing is left as it is; disable it unless the pass tests against this framebuffer's depth.
+     */
+    void renderFullscreen() {
+        this->bind();
+        glViewport(0, 0, this->viewportWidth, this->viewportHeight);
+        YGL_GL_COUNT(stateChanges, 1);
+        
+        // Core profiles need a vertex array object bound even without attributes.
+        if (fullscreenVAO == 0) glGenVertexArrays(1, &fullscreenVAO);
+        glBindVertexArray(fullscreenVAO);
+        
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        YGL_GL_COUNT(vertexArrayBinds, 1);
+        YGL_GL_COUNT(drawCalls, 1);
+        YGL_GL_COUNT(drawnVertices, 3);
         
         this->unbind();
     }
     
-    void render(GLFWwindow* window, const GLuint vao, const GLuint veo, const GLsizei count) {
+    /** Draw `count` indices of type `type`. `ObjData` elements are `GL_UNSIGNED_INT`, so pass it for them:
+     
+     ```
+     fb.render(window, obj.vao, obj.element3Buffer, obj.nElements3 * 3, GL_UNSIGNED_INT);
+     ```
+     */
+    void render(GLFWwindow* window, const GLuint vao, const GLuint veo, const GLsizei count,
+                const GLenum type = GL_UNSIGNED_SHORT) {
+        this->render(window, [&](bool) {
+            glBindVertexArray(vao);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, veo);
+            
+            glDrawElements(GL_TRIANGLES, count, type, 0);
+            YGL_GL_COUNT(vertexArrayBinds, 1);
+            YGL_GL_COUNT(bufferBinds, 1);
+            YGL_GL_COUNT(drawCalls, 1);
+            YGL_GL_COUNT(drawnVertices, count);
+        });
+    }
+    
+    /** Clear and render a scene drawn by `draw`.
+     
+     With `depthPrepass`, `draw` is called twice: `depthOnly` true for the depth pass(bind a cheap depth-only program there if there is one), then false for shading.
+     */
+    void render(GLFWwindow* window, const std::function<void(bool depthOnly)> &draw) {
         this->bind();
     //    std::cout << "render id : " << this->id << std::endl;
         
-        glViewport(0, 0, this->width, this->height);
-        glClearColor(0, 0, 0, 0);
         if (depthTest) {
             glEnable(GL_DEPTH_TEST);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            YGL_GL_COUNT(stateChanges, 1);
+            setViewportAndClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         } else {
-            glClear(GL_COLOR_BUFFER_BIT);
+            setViewportAndClear(GL_COLOR_BUFFER_BIT);
         }
         
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, veo);
-        
-        glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_SHORT, 0);
+        if (depthTest && depthPrepass) {
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            glDepthFunc(GL_LESS);
+            YGL_GL_COUNT(stateChanges, 2);
+            draw(true);
+            
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            glDepthFunc(GL_LEQUAL);
+            glDepthMask(GL_FALSE);
+            YGL_GL_COUNT(stateChanges, 3);
+            draw(false);
+            
+            glDepthMask(GL_TRUE);
+            glDepthFunc(GL_LESS);
+            YGL_GL_COUNT(stateChanges, 2);
+        } else {
+            draw(false);
+        }
         
         this->unbind();
     }
 
+    /** Set the viewport and clear only the viewport region, not the whole allocation.*/
+    void setViewportAndClear(const GLbitfield mask) {
+        glViewport(0, 0, this->viewportWidth, this->viewportHeight);
+        glClearColor(0, 0, 0, 0);
+        const bool partial = this->viewportWidth < this->width || this->viewportHeight < this->height;
+        if (partial) {
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(0, 0, this->viewportWidth, this->viewportHeight);
+        }
+        glClear(mask);
+        if (partial) glDisable(GL_SCISSOR_TEST);
+        YGL_GL_COUNT(stateChanges, partial ? 5 : 2);
+        YGL_GL_COUNT(clears, 1);
+    }
+
 //private:
     /** Bind this framebuffer object.*/
     void bind() {
-        glBindFramebuffer(GL_FRAMEBUFFER, this->id);
+        glBindFramebuffer(GL_FRAMEBUFFER, this->id != 0 ? this->id : defaultID);
+        YGL_GL_COUNT(framebufferBinds, 1);
     //    std::cout << "Framebuffer Bounded: " << this->id << std::endl;
     }
     /** Unbind this framebuffer object.*/
     void unbind() {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, defaultID);
+        YGL_GL_COUNT(framebufferBinds, 1);
     //    std::cout << "Framebuffer Unbounded: " << this->id << std::endl;
     }
 
     void cleanup() {
+        GPUMemory &memory = GPUMemory::get();
         if (this->id != 0) {
             glDeleteFramebuffers(1, &this->id);
         }
         for (auto i = 0; i < textureIDs.size(); i++) {
+            memory.untrack(GPUMemory::Texture, textureIDs[i]);
             glDeleteTextures(1, &textureIDs[i]);
         }
         if (this->renderbuffer != 0) {
+            memory.untrack(GPUMemory::Renderbuffer, this->renderbuffer);
             glDeleteRenderbuffers(1, &this->renderbuffer); // 렌더버퍼 삭제
         }
+        if (this->depthTextureID != 0) {
+            memory.untrack(GPUMemory::Texture, this->depthTextureID);
+            glDeleteTextures(1, &this->depthTextureID);
+        }
+        if (!colorRenderbuffers.empty()) {
+            for (auto rb : colorRenderbuffers) memory.untrack(GPUMemory::Renderbuffer, rb);
+            glDeleteRenderbuffers(int(colorRenderbuffers.size()), colorRenderbuffers.data());
+        }
+        if (this->fullscreenVAO != 0) {
+            glDeleteVertexArrays(1, &this->fullscreenVAO);
+        }
+        this->fullscreenVAO = 0;
+        this->id = 0;
+        this->renderbuffer = 0;
+        this->depthTextureID = 0;
+        this->colorRenderbuffers.clear();
+        this->bytesPerPixel = 0;
+        this->textureIDs.clear();
+        this->drawBufs.clear();
     }
 
 public:
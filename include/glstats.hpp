@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+/** Counts of GL calls made by YGL, by kind.
+
+ Counting is compiled in only when `YGL_GL_STATS` is defined before the YGL headers are included; otherwise `YGL_GL_COUNT` expands to nothing. Counters are per thread, so each render thread counts its own window.
+ */
+struct GLStats {
+    uint64_t drawCalls = 0;
+    /** Vertices or indices submitted by draw calls.*/
+    uint64_t drawnVertices = 0;
+    uint64_t programBinds = 0;
+    uint64_t uniformUpdates = 0;
+    uint64_t vertexArrayBinds = 0;
+    uint64_t bufferBinds = 0;
+    uint64_t textureBinds = 0;
+    uint64_t framebufferBinds = 0;
+    uint64_t clears = 0;
+    uint64_t blits = 0;
+    /** Fixed-function state: viewport, depth, color mask, scissor.*/
+    uint64_t stateChanges = 0;
+
+    uint64_t total() const {
+        return drawCalls + programBinds + uniformUpdates + vertexArrayBinds + bufferBinds +
+               textureBinds + framebufferBinds + clears + blits + stateChanges;
+    }
+
+    void reset() { *this = GLStats(); }
+
+    static GLStats &get() {
+        static thread_local GLStats stats;
+        return stats;
+    }
+};
+
+#ifdef YGL_GL_STATS
+#define YGL_GL_COUNT(counter, n) (GLStats::get().counter += (n))
+#else
+#define YGL_GL_COUNT(counter, n) ((void)0)
+#endif
@@ -0,0 +1,313 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct GPUResident;
+
+/** Registry of the GL buffers, textures and renderbuffers YGL allocates, with their sizes.
+
+ Memory is grouped by category("mesh", "framebuffer", ...) and owner(file name or object). With a `budget`, allocations of evictable resources(`GPUResident`: meshes, file textures) first evict the least recently used ones, which reload themselves from CPU data or disk when used again. Other allocations are counted but never evicted.
+
+ Shared by all threads. `reserve` only evicts residents registered on the calling thread: their GL objects belong to the context current there(vertex arrays are not shared between contexts), and a resident in use on another thread is never freed under it.
+ */
+struct GPUMemory {
+    enum Kind { Buffer, Texture, Renderbuffer, VertexArray };
+
+    static GPUMemory &get() {
+        // Never destroyed: global meshes and framebuffers untrack their objects after statics are gone.
+        static GPUMemory *memory = new GPUMemory;
+        return *memory;
+    }
+
+    /** Record an allocation. Tracking the same object again replaces its entry(e.g. after re-specifying storage).*/
+    void track(const Kind kind, const GLuint id, const size_t bytes,
+               const std::string &category, const std::string &owner = "") {
+        if (id == 0) return;
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        Allocation &a = allocations[key(kind, id)];
+        used -= a.bytes;
+        a = {kind, bytes, category, owner};
+        used += bytes;
+        peak = std::max(peak, used);
+    }
+
+    void untrack(const Kind kind, const GLuint id) {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        auto it = allocations.find(key(kind, id));
+        if (it == allocations.end()) return;
+        used -= it->second.bytes;
+        allocations.erase(it);
+    }
+
+    size_t usedBytes() const {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        return used;
+    }
+
+    size_t usedBytes(const std::string &category) const {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        size_t bytes = 0;
+        for (auto &entry : allocations)
+            if (entry.second.category == category) bytes += entry.second.bytes;
+        return bytes;
+    }
+
+    /** Budget in bytes for everything tracked. 0 means no limit.*/
+    void setBudget(const size_t bytes) {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        budget = bytes;
+        reserve(0);
+    }
+    size_t getBudget() const { return budget; }
+
+    /** Print memory by category, and by owner within each category.*/
+    void report(std::ostream &os = std::cout) const {
+        std::lock_guard<std::recursive_mutex> lock(mutex);
+        struct Sum { size_t bytes = 0; int count = 0; };
+        std::map<std::string, Sum> categories;
+        std::map<std::string, std::map<std::string, Sum>> owners;
+        for (auto &entry : allocations) {
+            const Allocation &a = entry.second;
+            Sum &c = categories[a.category];
+            c.bytes += a.bytes;
+            c.count++;
+            Sum &o = owners[a.category][a.owner];
+            o.bytes += a.bytes;
+            o.count++;
+        }
+
+        char line[256];
+        std::snprintf(line, sizeof(line), "GPU memory: %.2f MiB used, %.2f MiB peak, budget %s, %zu evictions\n",
+                      mib(used), mib(peak), budget ? (std::to_string(mib(budget)) + " MiB").c_str() : "none", evictions);
+        os << line;
+        for (auto &c : categories) {
+            std::snprintf(line, sizeof(line), "  %-16s %10.2f MiB  %5d objects\n", c.first.c_str(), mib(c.second.bytes), c.second.count);
+            os << line;
+            for (auto &o : owners[c.first]) {
+                std::snprintf(line, sizeof(line), "    %-30s %10.2f MiB  %5d objects\n",
+                              o.first.empty() ? "(unnamed)" : o.first.c_str(), mib(o.second.bytes), o.second.count);
+                os << line;
+            }
+        }
+    }
+
+    /** Evict least recently used residents until `bytes` more fit in the budget.
+
+     - Parameters:
+        - parameter keep: Resident that must stay, usually the one about to allocate.
+     - Returns: false when the budget cannot be met. The allocation should still go ahead; the budget is a target, not a hard limit.
+     */
+    bool reserve(const size_t bytes, const GPUResident *keep = nullptr);
+
+    size_t evictionCount() const { return evictions; }
+
+private:
+    friend struct GPUResident;
+
+    struct Allocation {
+        Kind kind;
+        size_t bytes;
+        std::string category;
+        std::string owner;
+    };
+
+    struct Resident {
+        GPUResident *owner;
+        void (*evict)(GPUResident &);
+        uint64_t lastUse;
+        /** Thread that uploaded the resident, whose context owns its GL objects.*/
+        std::thread::id thread;
+        /** Never evicted, e.g. while the GPU copy is newer than the CPU copy it would be restored from.*/
+        bool pinned = false;
+    };
+
+    static uint64_t key(const Kind kind, const GLuint id) { return uint64_t(kind) << 32 | id; }
+    static double mib(const size_t bytes) { return bytes / (1024.0 * 1024.0); }
+
+    GPUMemory() = default;
+
+    mutable std::recursive_mutex mutex;
+    std::unordered_map<uint64_t, Allocation> allocations;
+    size_t used = 0;
+    size_t peak = 0;
+    size_t budget = 0;
+    size_t evictions = 0;
+
+    std::unordered_map<uint64_t, Resident> residents;
+    uint64_t nextResident = 1;
+    uint64_t useClock = 0;
+};
+
+/** Owning name of one GL object. Deletes(and untracks) the object when destroyed.
+
+ Moves transfer ownership; copies start empty, so copying a mesh never shares or double-deletes its GL objects. Converts to `GLuint` for GL calls.
+ */
+struct GLName {
+    GLName() = default;
+    GLName(const GLName &) {}
+    GLName &operator=(const GLName &other) {
+        if (this != &other) reset();
+        return *this;
+    }
+    GLName(GLName &&other) noexcept : id(other.id), kind(other.kind) {
+        other.id = 0;
+    }
+    GLName &operator=(GLName &&other) noexcept {
+        if (this != &other) {
+            reset();
+            id = other.id;
+            kind = other.kind;
+            other.id = 0;
+        }
+        return *this;
+    }
+    ~GLName() { reset(); }
+
+    /** Replace with a new object of `kind`.*/
+    void generate(const GPUMemory::Kind kind) {
+        reset();
+        this->kind = kind;
+        switch (kind) {
+            case GPUMemory::Buffer:       glGenBuffers(1, &id); break;
+            case GPUMemory::Texture:      glGenTextures(1, &id); break;
+            case GPUMemory::Renderbuffer: glGenRenderbuffers(1, &id); break;
+            case GPUMemory::VertexArray:  glGenVertexArrays(1, &id); break;
+        }
+    }
+
+    void reset() {
+        if (id == 0) return;
+        GPUMemory::get().untrack(kind, id);
+        switch (kind) {
+            case GPUMemory::Buffer:       glDeleteBuffers(1, &id); break;
+            case GPUMemory::Texture:      glDeleteTextures(1, &id); break;
+            case GPUMemory::Renderbuffer: glDeleteRenderbuffers(1, &id); break;
+            case GPUMemory::VertexArray:  glDeleteVertexArrays(1, &id); break;
+        }
+        id = 0;
+    }
+
+    /** Record the object's size in `GPUMemory`.*/
+    void track(const size_t bytes, const std::string &category, const std::string &owner = "") const {
+        GPUMemory::get().track(kind, id, bytes, category, owner);
+    }
+
+    operator GLuint() const { return id; }
+
+    GLuint id = 0;
+    GPUMemory::Kind kind = GPUMemory::Buffer;
+};
+
+/** Base of resources `GPUMemory` may evict under its budget.
+
+ The derived type registers with `makeResident` after uploading, calls `touchResident` on every use, and checks `evicted` before use to reload. Like `GLName`, copies start unregistered and moves take over the registration.
+ */
+struct GPUResident {
+    /** Set when the GPU copy was evicted. Cleared by the next `makeResident`.*/
+    std::atomic<bool> evicted{false};
+
+    /** Keep the GPU copy from being evicted, or allow it again. A new `makeResident` unpins.*/
+    void pinResident(const bool pinned) {
+        if (residentID == 0) return;
+        GPUMemory &memory = GPUMemory::get();
+        std::lock_guard<std::recursive_mutex> lock(memory.mutex);
+        auto it = memory.residents.find(residentID);
+        if (it != memory.residents.end()) it->second.pinned = pinned;
+    }
+
+protected:
+    GPUResident() = default;
+    GPUResident(const GPUResident &) {}
+    GPUResident &operator=(const GPUResident &other) {
+        if (this != &other) releaseResidency();
+        return *this;
+    }
+    GPUResident(GPUResident &&other) noexcept {
+        take(other);
+    }
+    GPUResident &operator=(GPUResident &&other) noexcept {
+        if (this != &other) {
+            releaseResidency();
+            take(other);
+        }
+        return *this;
+    }
+    ~GPUResident() { releaseResidency(); }
+
+    /** Register as evictable by the calling thread. `evict` must free the GPU copy(resetting its `GLName`s untracks the memory).*/
+    void makeResident(void (*evict)(GPUResident &)) {
+        GPUMemory &memory = GPUMemory::get();
+        std::lock_guard<std::recursive_mutex> lock(memory.mutex);
+        if (residentID == 0) residentID = memory.nextResident++;
+        memory.residents[residentID] = {this, evict, ++memory.useClock, std::this_thread::get_id(), false};
+        evicted = false;
+    }
+
+    void touchResident() {
+        if (residentID == 0) return;
+        GPUMemory &memory = GPUMemory::get();
+        std::lock_guard<std::recursive_mutex> lock(memory.mutex);
+        auto it = memory.residents.find(residentID);
+        if (it != memory.residents.end()) it->second.lastUse = ++memory.useClock;
+    }
+
+    void releaseResidency() {
+        if (residentID == 0) return;
+        GPUMemory &memory = GPUMemory::get();
+        std::lock_guard<std::recursive_mutex> lock(memory.mutex);
+        memory.residents.erase(residentID);
+        residentID = 0;
+    }
+
+private:
+    friend struct GPUMemory;
+
+    void take(GPUResident &other) {
+        evicted = other.evicted.load();
+        if (other.residentID == 0) return;
+        GPUMemory &memory = GPUMemory::get();
+        std::lock_guard<std::recursive_mutex> lock(memory.mutex);
+        residentID = other.residentID;
+        other.residentID = 0;
+        auto it = memory.residents.find(residentID);
+        if (it != memory.residents.end()) it->second.owner = this;
+    }
+
+    uint64_t residentID = 0;
+};
+
+inline bool GPUMemory::reserve(const size_t bytes, const GPUResident *keep) {
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    if (budget == 0) return true;
+
+    // Few residents compared to allocations, so a linear search per eviction is cheap enough.
+    const std::thread::id thread = std::this_thread::get_id();
+    while (used + bytes > budget) {
+        auto victim = residents.end();
+        for (auto it = residents.begin(); it != residents.end(); ++it) {
+            if (it->second.owner == keep || it->second.pinned || it->second.thread != thread) continue;
+            if (victim == residents.end() || it->second.lastUse < victim->second.lastUse) victim = it;
+        }
+        if (victim == residents.end()) return false;
+
+        Resident r = victim->second;
+        residents.erase(victim);
+        r.owner->residentID = 0;
+        r.owner->evicted = true;
+        r.evict(*r.owner);
+        evictions++;
+    }
+    return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/** GPU time of a span of GL commands, from `GL_TIME_ELAPSED` queries.
+
+ Results arrive a few frames late. Queries rotate through a small ring, and `poll` only collects the ones already available, so timing never stalls the pipeline.
+ */
+struct GPUTimer {
+    static constexpr int nQueries = 4;
+
+    void init() {
+        cleanup();
+        glGenQueries(nQueries, queries);
+    }
+
+    /** Start timing. Skipped(false) when the GPU is so far behind that every query is still in flight.*/
+    bool begin() {
+        if (pending[current]) return timing = false;
+        glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+        return timing = true;
+    }
+
+    void end() {
+        if (!timing) return;
+        glEndQuery(GL_TIME_ELAPSED);
+        pending[current] = true;
+        current = (current + 1) % nQueries;
+        timing = false;
+    }
+
+    /** Collect finished queries, appending every result in milliseconds, oldest first. Several can finish between two polls.
+
+     - Returns: Number of results appended.
+     */
+    int poll(std::vector<double> &ms) {
+        int collected = 0;
+        for (int i = 0; i < nQueries; i++) {
+            int q = (current + i) % nQueries;
+            if (!pending[q]) continue;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[q], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) break;
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(queries[q], GL_QUERY_RESULT, &ns);
+            pending[q] = false;
+            ms.push_back(ns * 1e-6);
+            collected++;
+        }
+        return collected;
+    }
+
+    void cleanup() {
+        if (queries[0]) glDeleteQueries(nQueries, queries);
+        for (int i = 0; i < nQueries; i++) {
+            queries[i] = 0;
+            pending[i] = false;
+        }
+        current = 0;
+        timing = false;
+    }
+
+    ~GPUTimer() {
+        cleanup();
+    }
+
+private:
+    GLuint queries[nQueries] = {};
+    bool pending[nQueries] = {};
+    int current = 0;
+    bool timing = false;
+};
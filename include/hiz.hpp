@@ -0,0 +1,320 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <framebuffer.hpp>
+#include <program.hpp>
+#include <bounds.hpp>
+#include <gpumemory.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/** Hierarchical-Z occlusion culling.
+
+ Every frame:
+
+ 1. Render the frame(a `Framebuffer` with a depth texture, `depthPrepass` helps) and call `build` with its depth texture and view-projection.
+ 2. Call `fetch`, which picks up the pyramid of an earlier frame once the GPU has finished it, without stalling.
+ 3. Use `isVisible` or `cull` to decide what to draw next frame.
+
+ The GPU builds a max-depth mip pyramid. One coarse level(`readbackWidth` wide) is read back asynchronously and the rest of the pyramid is continued on the CPU, so the test is a handful of texel reads per object. Objects are tested against the view-projection the pyramid was built with, so results lag a frame and newly revealed objects appear one frame late.
+ */
+struct HiZBuffer {
+    GLuint texture = 0;
+    int width = 0, height = 0;
+    int nLevels = 0;
+    /** Width of the level read back to the CPU. Smaller is cheaper to copy but culls less.*/
+    int readbackWidth = 128;
+
+    /** Build pyramids of a framebuffer of this size.*/
+    void init(const int width, const int height) {
+        cleanup();
+        this->width = width;
+        this->height = height;
+        nLevels = 1 + int(std::floor(std::log2(float(std::max(width, height)))));
+
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        size_t textureBytes = 0;
+        for (int level = 0, w = width, h = height; level < nLevels; level++) {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, w, h, 0, GL_RED, GL_FLOAT, 0);
+            textureBytes += size_t(w) * h * sizeof(float);
+            w = std::max(1, w / 2);
+            h = std::max(1, h / 2);
+        }
+        GPUMemory::get().track(GPUMemory::Texture, texture, textureBytes, "hiz", "pyramid");
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, nLevels - 1);
+
+        glGenFramebuffers(1, &fbo);
+        glGenVertexArrays(1, &emptyVAO);
+        glGenBuffers(2, pbo);
+
+        copyProgram.loadShaderSource(Framebuffer::fullscreenVS, copyFS);
+        downsampleProgram.loadShaderSource(Framebuffer::fullscreenVS, downsampleFS);
+
+        readbackLevel = 0;
+        while (readbackLevel < nLevels - 1 && levelWidth(readbackLevel) > readbackWidth)
+            readbackLevel++;
+        for (auto id : pbo) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, id);
+            glBufferData(GL_PIXEL_PACK_BUFFER,
+                         levelWidth(readbackLevel) * levelHeight(readbackLevel) * sizeof(float),
+                         0,
+                         GL_STREAM_READ);
+            GPUMemory::get().track(GPUMemory::Buffer, id, levelWidth(readbackLevel) * levelHeight(readbackLevel) * sizeof(float),
+                                   "hiz", "readback");
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glErr("Error on HiZBuffer::init()");
+    }
+
+    /** Build the pyramid from a single-sampled depth texture and start its readback.
+
+     Keeps the viewport and depth test state, and binds the default framebuffer.
+
+     - Parameters:
+        - parameter depthTexture: Depth texture of the same size, e.g. `Framebuffer::depthTextureID`.
+        - parameter viewProj: Projection * view the depth was rendered with.
+     */
+    void build(const GLuint depthTexture, const glm::mat4 &viewProj) {
+        // The previous readback in this slot was never fetched. Drop it.
+        if (fence[writeSlot]) glDeleteSync(fence[writeSlot]);
+
+        GLboolean depthTestWasOn = glIsEnabled(GL_DEPTH_TEST);
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glDisable(GL_DEPTH_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glBindVertexArray(emptyVAO);
+        glActiveTexture(GL_TEXTURE0);
+
+        // Level 0: copy depth.
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        glViewport(0, 0, width, height);
+        copyProgram.use();
+        copyProgram.setUniform("depth", 0);
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        // Level i: max of the level i-1 texels it covers. Restricting the
+        // sampled range to level i-1 avoids a feedback loop with level i.
+        downsampleProgram.use();
+        downsampleProgram.setUniform("src", 0);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        for (int level = 1; level < nLevels; level++) {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, level);
+            glViewport(0, 0, levelWidth(level), levelHeight(level));
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, nLevels - 1);
+
+        // Asynchronous readback of the coarse level into a PBO.
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, readbackLevel);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[writeSlot]);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, levelWidth(readbackLevel), levelHeight(readbackLevel), GL_RED, GL_FLOAT, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        fence[writeSlot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        pendingViewProj[writeSlot] = viewProj;
+        writeSlot = 1 - writeSlot;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, Framebuffer::defaultID);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        if (depthTestWasOn) glEnable(GL_DEPTH_TEST);
+        glErr("Error on HiZBuffer::build()");
+    }
+
+    /** Take the newest finished readback, if any. Never waits for the GPU.
+
+     - Returns: true when the CPU pyramid was updated.
+     */
+    bool fetch() {
+        bool updated = false;
+        // Oldest slot first, so the newest finished one ends up in the CPU pyramid.
+        for (int i = 0; i < 2; i++) {
+            int slot = (writeSlot + i) % 2;
+            if (!fence[slot]) continue;
+            if (glClientWaitSync(fence[slot], 0, 0) == GL_TIMEOUT_EXPIRED) continue;
+            glDeleteSync(fence[slot]);
+            fence[slot] = 0;
+
+            int w = levelWidth(readbackLevel), h = levelHeight(readbackLevel);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[slot]);
+            auto *data = (const float *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, w * h * sizeof(float), GL_MAP_READ_BIT);
+            if (data) {
+                buildCPUPyramid(data, w, h);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                viewProj = pendingViewProj[slot];
+                updated = true;
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+        return updated;
+    }
+
+    /** Whether any part of a world space box may be visible in the fetched pyramid.
+
+     Conservative: true when there is no pyramid yet or the box crosses the near plane.
+     */
+    bool isVisible(const AABB &box) const {
+        if (levels.empty()) return true;
+
+        glm::vec2 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+        float minDepth = 1;
+        for (int i = 0; i < 8; i++) {
+            glm::vec4 clip = viewProj * glm::vec4(box.corner(i), 1);
+            if (clip.w <= 0) return true;
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            lo = glm::min(lo, glm::vec2(ndc.x, ndc.y));
+            hi = glm::max(hi, glm::vec2(ndc.x, ndc.y));
+            minDepth = std::min(minDepth, ndc.z * 0.5f + 0.5f);
+        }
+        if (hi.x < -1 || hi.y < -1 || lo.x > 1 || lo.y > 1) return false;
+        if (minDepth < 0) return true;
+
+        // Screen rect in level 0 texels, widened by one texel against rounding of the projected corners.
+        const CPULevel &base = levels[0];
+        lo = glm::clamp(lo * 0.5f + 0.5f, 0.f, 1.f);
+        hi = glm::clamp(hi * 0.5f + 0.5f, 0.f, 1.f);
+        const glm::ivec2 base0(std::max(int(lo.x * base.width) - 1, 0), std::max(int(lo.y * base.height) - 1, 0));
+        const glm::ivec2 base1(std::min(int(hi.x * base.width) + 1, base.width - 1),
+                               std::min(int(hi.y * base.height) + 1, base.height - 1));
+
+        // The same texels in the coarsest useful level: the one where the rect spans at most 2x2 texels.
+        // Texel x of level 0 is in texel x >> level, or the last one, which also covers odd leftovers.
+        int level = 0;
+        glm::ivec2 t0, t1;
+        for (;; level++) {
+            const CPULevel &l = levels[level];
+            t0 = glm::ivec2(std::min(base0.x >> level, l.width - 1), std::min(base0.y >> level, l.height - 1));
+            t1 = glm::ivec2(std::min(base1.x >> level, l.width - 1), std::min(base1.y >> level, l.height - 1));
+            if ((t1.x - t0.x < 2 && t1.y - t0.y < 2) || level == int(levels.size()) - 1) break;
+        }
+
+        const CPULevel &l = levels[level];
+        float maxDepth = 0;
+        for (int y = t0.y; y <= t1.y; y++)
+            for (int x = t0.x; x <= t1.x; x++)
+                maxDepth = std::max(maxDepth, l.depth[y * l.width + x]);
+        return minDepth <= maxDepth;
+    }
+
+    /** Indices of `boxes` that pass `isVisible`, to draw next frame.*/
+    void cull(const std::vector<AABB> &boxes, std::vector<uint32_t> &visible) const {
+        visible.clear();
+        for (uint32_t i = 0; i < boxes.size(); i++)
+            if (isVisible(boxes[i])) visible.push_back(i);
+    }
+
+    int levelWidth(const int level) const { return std::max(1, width >> level); }
+    int levelHeight(const int level) const { return std::max(1, height >> level); }
+
+    void cleanup() {
+        for (auto &f : fence) {
+            if (f) glDeleteSync(f);
+            f = 0;
+        }
+        GPUMemory &memory = GPUMemory::get();
+        memory.untrack(GPUMemory::Texture, texture);
+        memory.untrack(GPUMemory::Buffer, pbo[0]);
+        memory.untrack(GPUMemory::Buffer, pbo[1]);
+        if (texture) glDeleteTextures(1, &texture);
+        if (fbo) glDeleteFramebuffers(1, &fbo);
+        if (emptyVAO) glDeleteVertexArrays(1, &emptyVAO);
+        if (pbo[0]) glDeleteBuffers(2, pbo);
+        texture = fbo = emptyVAO = pbo[0] = pbo[1] = 0;
+        levels.clear();
+    }
+
+    ~HiZBuffer() {
+        cleanup();
+    }
+
+private:
+    struct CPULevel {
+        int width, height;
+        std::vector<float> depth;
+    };
+
+    /** Continue the max pyramid on the CPU from the read back level down to 1x1.*/
+    void buildCPUPyramid(const float *data, int w, int h) {
+        levels.resize(1);
+        levels[0].width = w;
+        levels[0].height = h;
+        levels[0].depth.assign(data, data + w * h);
+
+        while (w > 1 || h > 1) {
+            const CPULevel &src = levels.back();
+            CPULevel dst;
+            dst.width = std::max(1, w / 2);
+            dst.height = std::max(1, h / 2);
+            dst.depth.resize(dst.width * dst.height);
+            for (int y = 0; y < dst.height; y++) {
+                for (int x = 0; x < dst.width; x++) {
+                    // Odd sizes: the last texel also covers the leftover row/column.
+                    int x1 = x == dst.width - 1 ? src.width - 1 : 2 * x + 1;
+                    int y1 = y == dst.height - 1 ? src.height - 1 : 2 * y + 1;
+                    float d = 0;
+                    for (int sy = 2 * y; sy <= y1; sy++)
+                        for (int sx = 2 * x; sx <= x1; sx++)
+                            d = std::max(d, src.depth[sy * src.width + sx]);
+                    dst.depth[y * dst.width + x] = d;
+                }
+            }
+            w = dst.width;
+            h = dst.height;
+            levels.push_back(std::move(dst));
+        }
+    }
+
+    GLuint fbo = 0;
+    GLuint emptyVAO = 0;
+    GLuint pbo[2] = {0, 0};
+    GLsync fence[2] = {0, 0};
+    glm::mat4 pendingViewProj[2];
+    int writeSlot = 0;
+    int readbackLevel = 0;
+
+    Program copyProgram, downsampleProgram;
+
+    glm::mat4 viewProj;
+    std::vector<CPULevel> levels;
+
+    static constexpr const char *copyFS = R"(#version 410 core
+uniform sampler2D depth;
+out float hiz;
+void main() {
+    hiz = texelFetch(depth, ivec2(gl_FragCoord.xy), 0).r;
+}
+)";
+
+    static constexpr const char *downsampleFS = R"(#version 410 core
+uniform sampler2D src;
+out float hiz;
+void main() {
+    ivec2 srcSize = textureSize(src, 0);
+    ivec2 dst = ivec2(gl_FragCoord.xy);
+    ivec2 dstSize = max(srcSize / 2, ivec2(1));
+    // Odd sizes: the last texel also covers the leftover row/column.
+    ivec2 last = dst * 2 + 1;
+    if (dst.x == dstSize.x - 1) last.x = srcSize.x - 1;
+    if (dst.y == dstSize.y - 1) last.y = srcSize.y - 1;
+    float d = 0.0;
+    for (int y = dst.y * 2; y <= last.y; y++)
+        for (int x = dst.x * 2; x <= last.x; x++)
+            d = max(d, texelFetch(src, min(ivec2(x, y), srcSize - 1), 0).r);
+    hiz = d;
+}
+)";
+};
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <error.hpp>
+#include <glstats.hpp>
+#include <gpumemory.hpp>
+#include <objreader.hpp>
+#include <program.hpp>
+#include <texturearray.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/** Materials of all meshes in one uniform buffer, indexed by material ID.
+
+ Shaders read `materials[id]` from the `Materials` block declared by `glsl()`, and get the ID of the current draw from the `materialIndex` vertex attribute, which `setMaterial` sets as a constant(no array enabled). Changing material then costs one attribute update instead of a set of color uniforms, and draws sorted by material(`DrawQueue`) change it only when the material does.
+
+ ```
+ // vertex shader, after #version:
+ //   <table.glsl()>
+ //   layout(location = 7) in uint materialIndex;
+ //   flat out uint material;   ...   material = materialIndex;
+ MaterialTable table;
+ table.init();
+ table.add(obj);             // obj.materialID() is now valid
+ table.attach(program);
+ ```
+ A uniform block keeps it working on GL 4.1(macOS), which has no storage buffers. Its size limits the table to `capacity` materials: at least 204, and at most 1024.
+
+ ID 0 is a default grey material, for meshes without a .mtl file.
+ */
+struct MaterialTable {
+    /** One material in std140 layout. `w` of the colors is unused.*/
+    struct Entry {
+        glm::vec4 ambient;
+        glm::vec4 diffuse;
+        glm::vec4 specular;
+        /** `TextureSlot::uvRect` of the diffuse texture.*/
+        glm::vec4 uvRect;
+        /** `TextureSlot` array and layer of the diffuse texture; array -1 for none.*/
+        glm::ivec4 texture;
+    };
+
+    /** Vertex attribute location of the material ID.*/
+    static constexpr GLuint indexAttribute = 7;
+
+    /** Uniform buffer binding point of the table.*/
+    GLuint binding = 0;
+    /** Materials the block holds, from `GL_MAX_UNIFORM_BLOCK_SIZE`.*/
+    GLuint capacity = 0;
+
+    std::vector<Entry> entries;
+    std::vector<std::string> names;
+
+    /** Create the buffer with room for `capacity` materials, and add the default material.*/
+    void init(const GLuint binding = 0) {
+        cleanup();
+        this->binding = binding;
+
+        GLint maxBlockSize = 16384;
+        glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &maxBlockSize);
+        capacity = GLuint(std::min<size_t>(size_t(maxBlockSize) / sizeof(Entry), 1024));
+
+        // The whole block is allocated up front: binding a buffer smaller than the block is undefined.
+        buffer.generate(GPUMemory::Buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glLabel(GL_BUFFER, buffer, "material table");
+        glBufferData(GL_UNIFORM_BUFFER, GLsizeiptr(capacity * sizeof(Entry)), nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        buffer.track(capacity * sizeof(Entry), "material", "material table");
+
+        MtlData grey("default");
+        add(grey);
+    }
+
+    /** Append a material.
+
+     - Parameters:
+        - parameter diffuseMap: Slot of its diffuse texture in a `TextureArrayPacker`, if any.
+     - Returns: Its ID, or 0(the default material) when the table is full.
+     */
+    GLuint add(const MtlData &mtl, const TextureSlot &diffuseMap = TextureSlot()) {
+        if (entries.size() >= capacity) {
+            std::cerr << "Error on MaterialTable::add: table is full(" << capacity << "), " << mtl.materialName
+                      << " uses the default material." << std::endl;
+            return 0;
+        }
+        entries.push_back({glm::vec4(mtl.ambientColor, 1), glm::vec4(mtl.diffuseColor, 1), glm::vec4(mtl.specularColor, 1),
+                           diffuseMap.uvRect, glm::ivec4(diffuseMap.array, diffuseMap.layer, 0, 0)});
+        names.push_back(mtl.materialName);
+        return GLuint(entries.size() - 1);
+    }
+
+    /** Append all materials of `obj` and set `obj.materialBase`.
+
+     - Parameters:
+        - parameter textures: Packer for the `map_Kd` textures(files relative to `obj.prefix`). Call its `build` before drawing.
+     - Returns: ID of the first one.
+     */
+    GLuint add(ObjData &obj, TextureArrayPacker *textures = nullptr) {
+        GLuint base = GLuint(entries.size());
+        if (base + obj.materialData.size() > capacity) {
+            std::cerr << "Error on MaterialTable::add: no room for the " << obj.materialData.size()
+                      << " materials of " << obj.prefix + obj.objFile << "." << std::endl;
+            return obj.materialBase = 0;
+        }
+        for (auto &mtl : obj.materialData) {
+            TextureSlot slot;
+            if (textures && !mtl.diffuseMap.empty()) slot = textures->add(obj.prefix + mtl.diffuseMap);
+            add(mtl, slot);
+        }
+        return obj.materialBase = base;
+    }
+
+    /** Upload materials added since the last upload. `bind` does this when needed.*/
+    void upload() {
+        if (uploaded == entries.size()) return;
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, GLintptr(uploaded * sizeof(Entry)),
+                        GLsizeiptr((entries.size() - uploaded) * sizeof(Entry)), entries.data() + uploaded);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        YGL_GL_COUNT(bufferBinds, 2);
+        uploaded = entries.size();
+    }
+
+    /** Bind the table to `binding`. Once per frame is enough; programs share it.*/
+    void bind() {
+        upload();
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+        YGL_GL_COUNT(bufferBinds, 1);
+    }
+
+    /** Point `program`'s `Materials` block at `binding`. Once after linking: GLSL 4.1 has no `binding` layout qualifier.*/
+    void attach(const Program &program) const {
+        GLuint block = glGetUniformBlockIndex(program.programID, "Materials");
+        if (block == GL_INVALID_INDEX) {
+            std::cerr << "Error on MaterialTable::attach: program " << program.programID << " has no Materials block." << std::endl;
+            return;
+        }
+        glUniformBlockBinding(program.programID, block, binding);
+    }
+
+    /** Select material `id` for the following draws.*/
+    static void setMaterial(const GLuint id) {
+        glVertexAttribI1ui(indexAttribute, id);
+        YGL_GL_COUNT(stateChanges, 1);
+    }
+
+    /** GLSL declaration of the table, to paste after `#version` in shaders that read it.*/
+    std::string glsl() const {
+        return "struct Material { vec4 ambient; vec4 diffuse; vec4 specular; vec4 uvRect; ivec4 texture; };\n"
+               "layout(std140) uniform Materials { Material materials[" + std::to_string(std::max<GLuint>(capacity, 1)) + "]; };\n";
+    }
+
+    size_t size() const { return entries.size(); }
+
+    void cleanup() {
+        buffer.reset();
+        entries.clear();
+        names.clear();
+        uploaded = 0;
+    }
+
+private:
+    GLName buffer;
+    size_t uploaded = 0;
+};
@@ -0,0 +1,313 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <error.hpp>
+#include <gpumemory.hpp>
+#include <objreader.hpp>
+#include <program.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+/** Smooth normals, bounds and recentering of an `ObjData` with compute shaders, on the buffers `generateBuffers`(or `ObjStream`) created.
+
+ For meshes generated or deformed on the GPU, this avoids reading the vertices back and uploading the results. Needs GL 4.3(compute shaders, storage buffers, buffer clears); `init` returns false without them(macOS), and callers keep using the CPU functions.
+
+ - `smoothNormals` matches `ObjData::computeSmoothNormals`. Triangles add their unit normal to their corners with integer atomics in 16.16 fixed point, so the sum does not depend on thread order and results are identical run to run. A vertex can be shared by up to 32767 triangles.
+ - `bounds` matches `computeBounds`: a workgroup reduction, then atomic min/max on order-preserving integer encodings of the floats.
+ - `recenter` matches `adjustCenter`, shifting by the center of the reduced bounds without a CPU round trip.
+
+ Only the GPU buffers change. `bounds` and `recenter` read back 24 bytes of bounds to update the CPU fields, which waits for the GPU; `download` copies the buffers into `vertices` and `syncedNormals` when the CPU needs them. Until then `smoothNormals` and `recenter` pin the mesh in `GPUMemory`, since eviction would restore it from the stale CPU copy; `download`(or a new `generateBuffers`) makes it evictable again.
+ */
+struct MeshCompute {
+    static bool available() {
+        return GLEW_VERSION_4_3;
+    }
+
+    bool init() {
+        if (!available()) {
+            std::cerr << "Error on MeshCompute::init: compute shaders are not supported." << std::endl;
+            return false;
+        }
+        accumulate.loadComputeSource(std::string(header) + accumulateSource, "<MeshCompute accumulate>");
+        resolve.loadComputeSource(std::string(header) + resolveSource, "<MeshCompute resolve>");
+        reduce.loadComputeSource(std::string(header) + reduceSource, "<MeshCompute reduce>");
+        shift.loadComputeSource(std::string(header) + shiftSource, "<MeshCompute shift>");
+        ready = accumulate.programID && resolve.programID && reduce.programID && shift.programID;
+
+        boundsBuffer.generate(GPUMemory::Buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer);
+        glLabel(GL_BUFFER, boundsBuffer, "MeshCompute bounds");
+        glBufferData(GL_SHADER_STORAGE_BUFFER, 6 * sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        boundsBuffer.track(6 * sizeof(GLuint), "compute", "MeshCompute");
+        return ready;
+    }
+
+    /** Write smooth normals of `obj`'s triangles into its normal buffer.*/
+    bool smoothNormals(ObjData &obj) {
+        if (!prepare(obj)) return false;
+
+        const size_t accumBytes = size_t(obj.nVertices) * 3 * sizeof(GLint);
+        if (accumCapacity < accumBytes) {
+            accumBuffer.generate(GPUMemory::Buffer);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, accumBuffer);
+            glLabel(GL_BUFFER, accumBuffer, "MeshCompute normal sums");
+            glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(accumBytes), nullptr, GL_DYNAMIC_COPY);
+            accumBuffer.track(accumBytes, "compute", "MeshCompute");
+            accumCapacity = accumBytes;
+        }
+        GLint zero = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, accumBuffer);
+        glClearBufferSubData(GL_SHADER_STORAGE_BUFFER, GL_R32I, 0, GLsizeiptr(accumBytes), GL_RED_INTEGER, GL_INT, &zero);
+
+        // A mesh uploaded without normals(or streamed with fewer) needs a buffer of one normal per vertex.
+        const size_t normalBytes = size_t(obj.nVertices) * sizeof(glm::vec3);
+        if (obj.nSyncedNormals < obj.nVertices || obj.syncedNormalBuffer == 0) {
+            GLName normals;
+            normals.generate(GPUMemory::Buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, normals);
+            glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(normalBytes), nullptr, GL_STATIC_DRAW);
+            normals.track(normalBytes, "mesh", obj.objFile.empty() ? "(generated)" : obj.prefix + obj.objFile);
+            obj.syncedNormalBuffer = std::move(normals);
+            glBindVertexArray(obj.vao);
+            glBindBuffer(GL_ARRAY_BUFFER, obj.syncedNormalBuffer);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
+            glBindVertexArray(0);
+            obj.nSyncedNormals = obj.nVertices;
+        }
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, obj.vertexBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, obj.element3Buffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, accumBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, obj.syncedNormalBuffer);
+
+        accumulate.use();
+        accumulate.setUniformUint("count", obj.nElements3);
+        dispatch(obj.nElements3);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        resolve.use();
+        resolve.setUniformUint("count", obj.nVertices);
+        dispatch(obj.nVertices);
+        glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        obj.pinResident(true);
+        unbind();
+        glErr("Error on MeshCompute::smoothNormals()");
+        return true;
+    }
+
+    /** Set `obj.minPos`, `maxPos`, `center` and `scale` from its vertex buffer.*/
+    bool bounds(ObjData &obj) {
+        if (!prepare(obj)) return false;
+        reduceBounds(obj);
+        readBounds(obj);
+        unbind();
+        return true;
+    }
+
+    /** Move the vertices so the bounds are centered at the origin, like `adjustCenter`. Updates the CPU bounds(submeshes too).*/
+    bool recenter(ObjData &obj) {
+        if (!prepare(obj)) return false;
+        reduceBounds(obj);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, obj.vertexBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, boundsBuffer);
+        shift.use();
+        shift.setUniformUint("count", obj.nVertices);
+        dispatch(obj.nVertices);
+        glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        readBounds(obj);
+        obj.adjustCenterBounds();
+        obj.pinResident(true);
+        unbind();
+        glErr("Error on MeshCompute::recenter()");
+        return true;
+    }
+
+    /** Copy the vertex and normal buffers into `obj.vertices` and `obj.syncedNormals`, which makes the mesh evictable again. Waits for the GPU.*/
+    void download(ObjData &obj) const {
+        obj.vertices.resize(obj.nVertices);
+        obj.syncedNormals.resize(obj.nSyncedNormals);
+        glBindBuffer(GL_COPY_READ_BUFFER, obj.vertexBuffer);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, GLsizeiptr(obj.nVertices * sizeof(glm::vec3)), obj.vertices.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, obj.syncedNormalBuffer);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, 0, GLsizeiptr(obj.nSyncedNormals * sizeof(glm::vec3)), obj.syncedNormals.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        obj.pinResident(false);
+    }
+
+    void cleanup() {
+        accumBuffer.reset();
+        boundsBuffer.reset();
+        accumCapacity = 0;
+        ready = false;
+    }
+
+private:
+    static constexpr GLuint groupSize = 256;
+    /** Workgroups per dispatch. Shaders loop over the rest, so any mesh size fits the dispatch limit.*/
+    static constexpr GLuint maxGroups = 4096;
+
+    bool prepare(ObjData &obj) {
+        if (!ready) {
+            std::cerr << "Error on MeshCompute: call init() first." << std::endl;
+            return false;
+        }
+        if (obj.evicted) obj.restoreBuffers();
+        if (obj.vertexBuffer == 0 || obj.nVertices == 0) return false;
+        return true;
+    }
+
+    void dispatch(const GLuint items) const {
+        GLuint groups = std::min(std::max<GLuint>((items + groupSize - 1) / groupSize, 1), maxGroups);
+        glDispatchCompute(groups, 1, 1);
+    }
+
+    void reduceBounds(ObjData &obj) {
+        // Encoded +infinity for the minimum, -infinity for the maximum.
+        const GLuint init[6] = {0xFFFFFFFFu, 0xFFFFFFFFu, 0xFFFFFFFFu, 0, 0, 0};
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(init), init);
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, obj.vertexBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, boundsBuffer);
+        reduce.use();
+        reduce.setUniformUint("count", obj.nVertices);
+        dispatch(obj.nVertices);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    }
+
+    void readBounds(ObjData &obj) const {
+        GLuint bits[6];
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, boundsBuffer);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(bits), bits);
+        for (int k = 0; k < 3; k++) {
+            obj.minPos[k] = decode(bits[k]);
+            obj.maxPos[k] = decode(bits[3 + k]);
+        }
+        obj.center = (obj.maxPos + obj.minPos) * 0.5f;
+        obj.scale = obj.maxPos - obj.minPos;
+    }
+
+    /** Inverse of `ordered` in the shaders.*/
+    static float decode(const GLuint bits) {
+        uint32_t u = bits & 0x80000000u ? bits & 0x7FFFFFFFu : ~bits;
+        float f;
+        std::memcpy(&f, &u, sizeof(f));
+        return f;
+    }
+
+    void unbind() const {
+        for (GLuint i = 0; i < 4; i++) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, 0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    Program accumulate, resolve, reduce, shift;
+    GLName accumBuffer, boundsBuffer;
+    size_t accumCapacity = 0;
+    bool ready = false;
+
+    static constexpr const char *header = R"(#version 430 core
+layout(local_size_x = 256) in;
+uniform uint count;
+// Grid-stride loop over [0, count).
+#define FOR_EACH(i) for (uint i = gl_GlobalInvocationID.x; i < count; i += gl_NumWorkGroups.x * 256u)
+)";
+
+    static constexpr const char *accumulateSource = R"(
+layout(std430, binding = 0) readonly buffer Vertices { float v[]; };
+layout(std430, binding = 1) readonly buffer Elements { uint e[]; };
+layout(std430, binding = 2) buffer Sums { int sums[]; };
+const float scale = 65536.0;
+vec3 vertex(uint i) { return vec3(v[3u * i], v[3u * i + 1u], v[3u * i + 2u]); }
+void main() {
+    FOR_EACH(t) {
+        uvec3 c = uvec3(e[3u * t], e[3u * t + 1u], e[3u * t + 2u]);
+        vec3 a = vertex(c.x);
+        vec3 n = cross(vertex(c.y) - a, vertex(c.z) - a);
+        float len = length(n);
+        if (len == 0.0) continue;
+        ivec3 q = ivec3(round(n / len * scale));
+        for (int k = 0; k < 3; k++) {
+            atomicAdd(sums[3u * c[k]], q.x);
+            atomicAdd(sums[3u * c[k] + 1u], q.y);
+            atomicAdd(sums[3u * c[k] + 2u], q.z);
+        }
+    }
+}
+)";
+
+    static constexpr const char *resolveSource = R"(
+layout(std430, binding = 2) readonly buffer Sums { int sums[]; };
+layout(std430, binding = 3) writeonly buffer Normals { float n[]; };
+void main() {
+    FOR_EACH(i) {
+        vec3 s = vec3(sums[3u * i], sums[3u * i + 1u], sums[3u * i + 2u]);
+        float len = length(s);
+        vec3 r = len > 0.0 ? s / len : vec3(0.0);
+        n[3u * i] = r.x;
+        n[3u * i + 1u] = r.y;
+        n[3u * i + 2u] = r.z;
+    }
+}
+)";
+
+    static constexpr const char *reduceSource = R"(
+layout(std430, binding = 0) readonly buffer Vertices { float v[]; };
+layout(std430, binding = 1) buffer Bounds { uint lo[3]; uint hi[3]; };
+shared vec3 sMin[256];
+shared vec3 sMax[256];
+// Floats as uints that compare in the same order.
+uint ordered(float f) {
+    uint u = floatBitsToUint(f);
+    return (u & 0x80000000u) != 0u ? ~u : u | 0x80000000u;
+}
+void main() {
+    vec3 mn = vec3(3.402823e38), mx = vec3(-3.402823e38);
+    FOR_EACH(i) {
+        vec3 p = vec3(v[3u * i], v[3u * i + 1u], v[3u * i + 2u]);
+        mn = min(mn, p);
+        mx = max(mx, p);
+    }
+    uint l = gl_LocalInvocationIndex;
+    sMin[l] = mn;
+    sMax[l] = mx;
+    barrier();
+    for (uint s = 128u; s > 0u; s >>= 1) {
+        if (l < s) {
+            sMin[l] = min(sMin[l], sMin[l + s]);
+            sMax[l] = max(sMax[l], sMax[l + s]);
+        }
+        barrier();
+    }
+    if (l == 0u)
+        for (int k = 0; k < 3; k++) {
+            atomicMin(lo[k], ordered(sMin[0][k]));
+            atomicMax(hi[k], ordered(sMax[0][k]));
+        }
+}
+)";
+
+    static constexpr const char *shiftSource = R"(
+layout(std430, binding = 0) buffer Vertices { float v[]; };
+layout(std430, binding = 1) readonly buffer Bounds { uint lo[3]; uint hi[3]; };
+float decode(uint u) { return uintBitsToFloat((u & 0x80000000u) != 0u ? u & 0x7FFFFFFFu : ~u); }
+void main() {
+    vec3 center = vec3(decode(lo[0]) + decode(hi[0]), decode(lo[1]) + decode(hi[1]), decode(lo[2]) + decode(hi[2])) * 0.5;
+    FOR_EACH(i) {
+        v[3u * i] -= center.x;
+        v[3u * i + 1u] -= center.y;
+        v[3u * i + 2u] -= center.z;
+    }
+}
+)";
+};
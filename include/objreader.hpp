@@ -6,11 +6,29 @@
 
 #include <glm/glm.hpp> // vec3
 
+#include <arena.hpp>
+#include <bounds.hpp>
+#include <error.hpp>
+#include <glstats.hpp>
+#include <gpumemory.hpp>
+#include <threadpool.hpp>
+
+#include <algorithm>
+#include <cctype>
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#if !defined(__cpp_lib_to_chars)
+#include <locale.h> // strtof_l
+#endif
+#include <cstdlib>
+#include <cstring>
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include <iterator>
 #include <limits>
-#include <regex>
+#include <map>
 #include <string>
 #include <unistd.h>
 
@@ -18,9 +36,11 @@ struct MtlData
 {
     std::string materialName;
 
-    glm::vec3 ambientColor;
-    glm::vec3 diffuseColor;
-    glm::vec3 specularColor;
+    glm::vec3 ambientColor = glm::vec3(0);
+    glm::vec3 diffuseColor = glm::vec3(0.8f);
+    glm::vec3 specularColor = glm::vec3(0);
+    /** `map_Kd` texture file, relative to the mesh's prefix. Empty if none.*/
+    std::string diffuseMap;
 
     MtlData(const std::string mName) : materialName(mName) {}
 
@@ -34,9 +54,64 @@ struct MtlData
     }
 };
 
-struct ObjData
+/** Wavefront OBJ mesh: CPU data from `loadObject`, GPU buffers from `generateBuffers`.
+ 
+ The buffers count against the `GPUMemory` budget as category "mesh" and may be evicted when unused; `render` uploads them again, reloading the file if the CPU data is gone(`keepCPUData` false or `releaseCPUData`).
+ */
+struct ObjData : GPUResident
 {
+    /** Faces of one `o`/`g` group with one `usemtl` material: a range of `elements3`.*/
+    struct Submesh {
+        /** Group name, empty before the first `o`/`g` line.*/
+        std::string name;
+        /** Material name, empty before the first `usemtl` line.*/
+        std::string material;
+        /** Index range in the element buffer(3 per triangle), for `draw`.*/
+        GLuint first = 0;
+        GLuint count = 0;
+        glm::vec3 minPos = glm::vec3( 987654321);
+        glm::vec3 maxPos = glm::vec3(-987654321);
+    };
+    
+    /** Changed element ranges of one CPU array, [first, last) each, kept sorted and merged.*/
+    struct DirtyRanges {
+        /** Beyond this many ranges, the nearest ones are merged: one upload with a small gap beats many tiny ones.*/
+        static constexpr size_t maxRanges = 16;
+        std::vector<std::pair<size_t, size_t>> ranges;
+        
+        void add(const size_t first, const size_t last) {
+            if (first >= last) return;
+            auto it = std::lower_bound(ranges.begin(), ranges.end(), std::make_pair(first, last));
+            it = ranges.insert(it, {first, last});
+            // Merge with overlapping or touching neighbours.
+            if (it != ranges.begin() && std::prev(it)->second >= it->first) it = std::prev(it);
+            while (std::next(it) != ranges.end() && std::next(it)->first <= it->second) {
+                it->second = std::max(it->second, std::next(it)->second);
+                ranges.erase(std::next(it));
+            }
+            while (ranges.size() > maxRanges) {
+                size_t nearest = 0;
+                for (size_t i = 1; i + 1 < ranges.size(); i++)
+                    if (ranges[i + 1].first - ranges[i].second < ranges[nearest + 1].first - ranges[nearest].second) nearest = i;
+                ranges[nearest].second = ranges[nearest + 1].second;
+                ranges.erase(ranges.begin() + nearest + 1);
+            }
+        }
+        
+        /** Elements covered by the ranges.*/
+        size_t size() const {
+            size_t n = 0;
+            for (auto &r : ranges) n += r.second - r.first;
+            return n;
+        }
+        
+        bool empty() const { return ranges.empty(); }
+        void clear() { ranges.clear(); }
+    };
+    
     std::string prefix = "";
+    /** File passed to `loadObject`, relative to `prefix`.*/
+    std::string objFile = "";
     std::string materialFile = "";
     std::string material = "";
     GLuint nVertices = 0;
@@ -44,7 +119,7 @@ struct ObjData
     GLuint nElements4 = 0;
     GLuint nNormals = 0;
     GLuint nSyncedNormals = 0;
-    bool isOk;
+    bool isOk = false;
     glm::vec3 maxPos;
     glm::vec3 minPos;
     glm::vec3 center;
@@ -54,13 +129,35 @@ struct ObjData
     std::vector<glm::vec2> textures;
     std::vector<glm::vec3> normals;
     std::vector<glm::vec3> syncedNormals;
-    std::vector<glm::u16vec3> elements3;
-    std::vector<glm::u16vec4> elements4;
+    std::vector<glm::uvec3> elements3;
+    std::vector<glm::uvec4> elements4;
 
+    /** Parts of the mesh by group and material. All share the mesh's buffers.*/
+    std::vector<Submesh> submeshes;
+    
     std::vector<MtlData> materialData;
+    /** ID of `materialData[0]` in the `MaterialTable` it was added to.*/
+    GLuint materialBase = 0;
+    
+    /** Keep the CPU geometry after `generateBuffers`. With false it is freed once uploaded(`releaseCPUData`).*/
+    bool keepCPUData = true;
+    /** Total shift applied by `adjustCenter`, applied again when an evicted mesh is reloaded.*/
+    glm::vec3 centerShift = glm::vec3(0);
     
-    GLuint vao;
-    GLuint vertexBuffer, syncedNormalBuffer, element3Buffer;
+    /** CPU edits not yet uploaded, in vertices, normals and triangles. See `syncBuffers`.*/
+    DirtyRanges dirtyVertices, dirtyNormals, dirtyElements;
+    /** When `syncBuffers` must grow a buffer, it allocates this times the size needed, so further appends fit.*/
+    float growth = 1.5f;
+    /** When more than this fraction of a buffer changed, `syncBuffers` orphans it and uploads it whole instead of in ranges.*/
+    float orphanFraction = 0.5f;
+    
+    GLName vao;
+    GLName vertexBuffer, syncedNormalBuffer, element3Buffer;
+    /** `vn` normals as read, only for meshes loaded by `ObjStream`.*/
+    GLName rawNormalBuffer;
+    /** Chunk size of the `ObjStream` that loaded this mesh, 0 if loaded whole.*/
+    size_t streamChunkBytes = 0;
+    friend struct ObjStream;
 
     void setPrefix(const std::string &prefixName) {
         if(prefixName.length() == 0) {
@@ -100,6 +197,16 @@ struct ObjData
                 float r, g, b;
                 file >> r >> g >> b;
                 this->materialData.back().specularColor = {r, g, b};
+            } else if (type == "map_Kd") {
+                // Options(-blendu, -s, ...) come first; the file name is last.
+                std::string line;
+                std::getline(file, line);
+                size_t end = line.find_last_not_of(" \t\r");
+                if (end != std::string::npos) {
+                    size_t start = line.find_last_of(" \t", end);
+                    start = start == std::string::npos ? 0 : start + 1;
+                    this->materialData.back().diffuseMap = line.substr(start, end - start + 1);
+                }
             }
         }
 
@@ -109,10 +216,31 @@ struct ObjData
         }
     }
     
+    /** Index of the material called `name` in `materialData`, or -1.*/
+    int materialIndex(const std::string &name) const {
+        for (size_t i = 0; i < materialData.size(); i++)
+            if (materialData[i].materialName == name) return int(i);
+        return -1;
+    }
+    
+    /** `MaterialTable` ID of `material`, or 0(the table's default material) when it has none.*/
+    GLuint materialID() const {
+        return materialID(material);
+    }
+    
+    GLuint materialID(const Submesh &submesh) const {
+        return materialID(submesh.material);
+    }
+    
+    GLuint materialID(const std::string &name) const {
+        int index = materialIndex(name);
+        return index < 0 ? 0 : materialBase + GLuint(index);
+    }
+    
     void loadObject(const std::string &objFileName) {
         isOk = false;
-        maxPos = glm::vec3(-987654321);
-        minPos = glm::vec3( 987654321);
+        objFile = objFileName;
+        submeshes.clear();
 
         std::fstream file(prefix + objFileName);
         if (!file.is_open()) {
@@ -121,9 +249,29 @@ struct ObjData
         }
         std::cout << "Read " << prefix + objFileName << std::endl;
 
-        std::vector<std::string> faces;
-
-        std::string type;
+        // Parse scratch lives in one arena, freed in one go when the load returns.
+        Arena arena;
+        const LineCounts lines = countLines(prefix + objFileName);
+        this->vertices.reserve(this->vertices.size() + lines.vertices);
+        this->textures.reserve(this->textures.size() + lines.textures);
+        this->normals.reserve(this->normals.size() + lines.normals);
+        
+        // Text of all faces back to back; faceStart[i] .. faceStart[i + 1] is face i.
+        ArenaVector<char> faceText{ArenaAllocator<char>(arena)};
+        ArenaVector<size_t> faceStart{ArenaAllocator<size_t>(arena)};
+        // Submesh of each face, by group and material.
+        ArenaVector<GLuint> faceSubmesh{ArenaAllocator<GLuint>(arena)};
+        faceText.reserve(lines.faceBytes);
+        faceStart.reserve(lines.faces + 1);
+        faceSubmesh.reserve(lines.faces);
+        std::map<std::pair<std::string, std::string>, GLuint> submeshOf;
+        std::string group;
+        // Submesh of the latest face; looked up again only after `o`, `g` or `usemtl`.
+        GLuint currentSubmesh = GLuint(-1);
+        
+        // Triangles and quads by token count, to reserve the element arrays.
+        size_t triangleHint = 0, quadHint = 0;
+        std::string type, f;
         while (!file.eof()) {
             file >> type;
             if (file.eof())
@@ -133,35 +281,47 @@ struct ObjData
                 this->loadMtl(this->materialFile);
             } else if (type == "usemtl") {
                 file >> this->material;
+                currentSubmesh = GLuint(-1);
             } else if (type == "o" || type == "g") {
-                if (!file.ignore(std::numeric_limits<std::streamsize>::max(),
-                                 file.widen('\n'))) {
-                    std::cerr << "Group Skip!" << std::endl;
-                }
-            } else if (type == "v") {
+                std::getline(file, group);
+                size_t first = group.find_first_not_of(" \t\r"), last = group.find_last_not_of(" \t\r");
+                group = first == std::string::npos ? "" : group.substr(first, last - first + 1);
+                currentSubmesh = GLuint(-1);
+            } else if (type == "v" || type == "vt" || type == "vn") {
+                // Parse the line in place: `operator>>` allocates a string for every float it reads.
+                std::getline(file, f);
+                const char *p = f.c_str(), *lineEnd = p + f.size();
                 float x, y, z;
-                file >> x >> y >> z;
-                this->vertices.push_back({x, y, z});
-                
-                if(maxPos.x < x) maxPos.x = x;
-                else if(minPos.x > x) minPos.x = x;
-                if(maxPos.y < y) maxPos.y = y;
-                else if(minPos.y > y) minPos.y = y;
-                if(maxPos.z < z) maxPos.z = z;
-                else if(minPos.z > z) minPos.z = z;
-            } else if (type == "vt") {
-                float tx, ty;
-                file >> tx >> ty;
-                this->textures.push_back({tx, ty});
-            } else if (type == "vn") {
-                float nx, ny, nz;
-                file >> nx >> ny >> nz;
-                this->normals.push_back({nx, ny, nz});
+                p = parseFloat(p, lineEnd, x);
+                p = parseFloat(p, lineEnd, y);
+                if (type == "vt") {
+                    this->textures.push_back({x, y});
+                    continue;
+                }
+                parseFloat(p, lineEnd, z);
+                if (type == "v") this->vertices.push_back({x, y, z});
+                else this->normals.push_back({x, y, z});
             } else if (type == "f") {
-                std::string f;
                 std::getline(file, f);
-
-                faces.push_back(f);
+                
+                size_t tokens = 0;
+                for (size_t k = 0; k < f.size(); k++)
+                    if (!std::isspace(static_cast<unsigned char>(f[k])) && (k == 0 || std::isspace(static_cast<unsigned char>(f[k - 1])))) tokens++;
+                triangleHint += tokens == 4 ? 2 : 1;
+                quadHint += tokens == 4;
+                
+                faceStart.push_back(faceText.size());
+                faceText.insert(faceText.end(), f.begin(), f.end());
+                if (currentSubmesh == GLuint(-1)) {
+                    auto key = std::make_pair(group, this->material);
+                    auto found = submeshOf.find(key);
+                    if (found == submeshOf.end()) {
+                        found = submeshOf.emplace(key, GLuint(submeshes.size())).first;
+                        submeshes.push_back({group, this->material});
+                    }
+                    currentSubmesh = found->second;
+                }
+                faceSubmesh.push_back(currentSubmesh);
             } else if (type == "l") {
                 // not in this case
                 if (!file.ignore(std::numeric_limits<std::streamsize>::max(),
@@ -178,57 +338,75 @@ struct ObjData
             }
             // std::cout << "Processing type " << type << std::endl;
         }
+        const size_t nFaces = faceSubmesh.size();
+        faceStart.push_back(faceText.size());
 
         this->nVertices = (int)this->vertices.size();
 
-        std::vector<std::vector<glm::vec3>> sNormals(this->nVertices);
-
-        for (auto f : faces) {
+        // Vertex and normal index of every face corner.
+        ArenaVector<glm::uvec2> corners{ArenaAllocator<glm::uvec2>(arena)};
+        corners.reserve(nFaces * 4);
+        // Triangles go straight to `elements3` in file order. With several submeshes they are sorted by submesh below, so each submesh is one index range.
+        const bool sortBySubmesh = submeshes.size() > 1;
+        ArenaVector<GLuint> triangleSubmesh{ArenaAllocator<GLuint>(arena)};
+        if (sortBySubmesh) triangleSubmesh.reserve(triangleHint);
+        const size_t base = this->elements3.size();
+        this->elements3.reserve(base + triangleHint);
+        this->elements4.reserve(this->elements4.size() + quadHint);
+        
+        for (size_t i = 0; i < nFaces; i++) {
             // case by case?
-            std::vector<GLuint> elem;
-
-            std::regex re("\\d+/\\d*/\\d+");
-            auto start = std::sregex_iterator(f.begin(), f.end(), re);
-            auto end = std::sregex_iterator();
-            while (start != end) {
-                std::string str = start->str();
-                GLuint vertex = std::stoi(str.substr(0, str.find('/'))) - 1;
-                elem.push_back(vertex);
-
-                GLuint normal =
-                    std::stoi(str.substr(str.find_last_of('/') + 1)) - 1;
-                sNormals[vertex].push_back(this->normals[normal]);
-
-                start++;
+            GLuint elem[4];
+            size_t n = 0;
+            
+            const char *p = faceText.data() + faceStart[i];
+            const char *end = faceText.data() + faceStart[i + 1];
+            GLuint vertex, normal;
+            while ((p = nextCorner(p, end, vertex, normal)) != nullptr) {
+                if (n < 4) elem[n] = vertex;
+                n++;
+                corners.push_back({vertex, normal});
             }
 
-            if (elem.size() == 4) {
+            if (n == 4) {
                 this->elements4.push_back({elem[0], elem[1], elem[2], elem[3]});
                 this->elements3.push_back({elem[0], elem[1], elem[2]});
                 this->elements3.push_back({elem[0], elem[2], elem[3]});
-            } else if (elem.size() == 3)
+                if (sortBySubmesh) triangleSubmesh.insert(triangleSubmesh.end(), 2, faceSubmesh[i]);
+            } else if (n == 3) {
                 this->elements3.push_back({elem[0], elem[1], elem[2]});
-            else {
+                if (sortBySubmesh) triangleSubmesh.push_back(faceSubmesh[i]);
+            } else {
                 std::cerr << "Weird situation! f elements size is not 3 or 4."
                           << std::endl;
                 return;
             }
         }
 
-        for (auto sn : sNormals) {
-            glm::vec3 sum(0);
-            for (auto n : sn)
-                sum += n;
-            sum /= sn.size();
-            this->syncedNormals.push_back(sum);
+        // Counting sort by submesh, keeping file order within each.
+        std::vector<GLuint> next(submeshes.size() + 1, 0);
+        if (sortBySubmesh)
+            for (GLuint s : triangleSubmesh) next[s + 1]++;
+        else if (!submeshes.empty())
+            next[1] = GLuint(this->elements3.size() - base);
+        for (size_t i = 0; i < submeshes.size(); i++) {
+            next[i + 1] += next[i];
+            submeshes[i].first = GLuint(base + next[i]) * 3;
+            submeshes[i].count = (next[i + 1] - next[i]) * 3;
+        }
+        if (sortBySubmesh) {
+            ArenaVector<glm::uvec3> fileOrder(this->elements3.begin() + base, this->elements3.end(), ArenaAllocator<glm::uvec3>(arena));
+            for (size_t t = 0; t < fileOrder.size(); t++)
+                this->elements3[base + next[triangleSubmesh[t]]++] = fileOrder[t];
         }
 
         this->nElements3 = (int)this->elements3.size();
         this->nElements4 = (int)this->elements4.size();
         this->nNormals = (int)this->normals.size();
-        this->nSyncedNormals = (int)this->syncedNormals.size();
-        center = (maxPos + minPos) * 0.5f;
-        scale = maxPos - minPos;
+
+        computeSyncedNormals(corners);
+        computeBounds();
+        computeSubmeshBounds();
 
 
         std::cout << "nVertices: " << this->nVertices << std::endl;
@@ -236,6 +414,7 @@ struct ObjData
         std::cout << "nElements4: " << this->nElements4 << std::endl;
         std::cout << "nNormals: " << this->nNormals << std::endl;
         std::cout << "nSyncedNormals: " << this->nSyncedNormals << std::endl;
+        std::cout << "nSubmeshes: " << this->submeshes.size() << std::endl;
         
         std::cout << "maxPos: " << maxPos.x << ", " << maxPos.y << ", " << maxPos.z << std::endl;
         std::cout << "minPos: " << minPos.x << ", " << minPos.y << ", " << minPos.z << std::endl;
@@ -258,45 +437,802 @@ struct ObjData
         return this->loadObject(objFileName);
     }
     
+    /** Average the normals of all corners sharing a vertex into `syncedNormals`.
+     
+     - Parameters:
+        - parameter corners: Vertex and normal index of each face corner.
+     */
+    template <typename Corners>
+    void computeSyncedNormals(const Corners &corners) {
+        std::vector<GLuint> first, used;
+        vertexAdjacency(corners.size(), [&](size_t c) { return corners[c].x; }, first, used);
+        this->syncedNormals.assign(nVertices, glm::vec3(0));
+        ThreadPool::get().parallelFor(nVertices, [&](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; v++) {
+                glm::vec3 sum(0);
+                for (GLuint i = first[v]; i < first[v + 1]; i++) sum += this->normals[corners[used[i]].y];
+                const GLuint count = first[v + 1] - first[v];
+                this->syncedNormals[v] = count ? sum / float(count) : glm::vec3(0);
+            }
+        });
+        markNormalsDirty(0, nVertices);
+        this->nSyncedNormals = (int)this->syncedNormals.size();
+    }
+    
+    /** Set `syncedNormals` to the normalized sum of the unit normals of the triangles around each vertex.
+     
+     For generated meshes or files without `vn`. `MeshCompute::smoothNormals` does the same on the GPU.
+     */
+    void computeSmoothNormals() {
+        std::vector<glm::vec3> faceNormals(nElements3);
+        ThreadPool::get().parallelFor(nElements3, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const glm::uvec3 &t = elements3[i];
+                glm::vec3 n = glm::cross(vertices[t.y] - vertices[t.x], vertices[t.z] - vertices[t.x]);
+                float length = glm::length(n);
+                faceNormals[i] = length == 0 ? glm::vec3(0) : n / length;
+            }
+        });
+        std::vector<GLuint> first, used;
+        vertexAdjacency(size_t(nElements3) * 3, [&](size_t c) { return elements3[c / 3][int(c % 3)]; }, first, used);
+        this->syncedNormals.assign(nVertices, glm::vec3(0));
+        ThreadPool::get().parallelFor(nVertices, [&](size_t begin, size_t end) {
+            for (size_t v = begin; v < end; v++) {
+                glm::vec3 sum(0);
+                for (GLuint i = first[v]; i < first[v + 1]; i++) sum += faceNormals[used[i] / 3];
+                float length = glm::length(sum);
+                this->syncedNormals[v] = length > 0 ? sum / length : glm::vec3(0);
+            }
+        });
+        markNormalsDirty(0, nVertices);
+        this->nSyncedNormals = nVertices;
+    }
+    
+    /** Set `minPos`, `maxPos`, `center` and `scale` from `vertices`, as a parallel reduction.*/
+    void computeBounds() {
+        AABB b = ThreadPool::get().reduce(vertices.size(), emptyBounds(), [&](size_t begin, size_t end) {
+            AABB part = emptyBounds();
+            for (size_t i = begin; i < end; i++) part.expand(vertices[i]);
+            return part;
+        }, mergeBounds);
+        minPos = b.min;
+        maxPos = b.max;
+        center = (maxPos + minPos) * 0.5f;
+        scale = maxPos - minPos;
+    }
+    
+    /** Set each submesh's bounds from the vertices its triangles use.*/
+    void computeSubmeshBounds() {
+        for (auto &s : submeshes) {
+            const size_t firstTriangle = s.first / 3;
+            AABB b = ThreadPool::get().reduce(s.count / 3, emptyBounds(), [&](size_t begin, size_t end) {
+                AABB part = emptyBounds();
+                for (size_t t = firstTriangle + begin; t < firstTriangle + end; t++)
+                    for (int k = 0; k < 3; k++) part.expand(vertices[elements3[t][k]]);
+                return part;
+            }, mergeBounds);
+            s.minPos = b.min;
+            s.maxPos = b.max;
+        }
+    }
+    
+    /** Corners around each vertex, in compressed sparse rows: the corners of vertex v are `used[first[v]]` to `used[first[v + 1] - 1]`.
+     
+     A counting sort keeps the corners of each vertex in file order, so gathering over them adds in the same order as a serial scatter over the faces, and the sums are the same bit for bit.
+     
+     - Parameters:
+        - parameter nCorners: Number of corners.
+        - parameter vertexOf: Vertex of corner `c`.
+     */
+    template <typename VertexOf>
+    void vertexAdjacency(const size_t nCorners, VertexOf vertexOf, std::vector<GLuint> &first, std::vector<GLuint> &used) const {
+        first.assign(size_t(nVertices) + 1, 0);
+        for (size_t c = 0; c < nCorners; c++) first[vertexOf(c) + 1]++;
+        for (size_t v = 0; v < nVertices; v++) first[v + 1] += first[v];
+        used.resize(nCorners);
+        std::vector<GLuint> next(first.begin(), first.end() - 1);
+        for (size_t c = 0; c < nCorners; c++) used[next[vertexOf(c)]++] = GLuint(c);
+    }
+    
+    /** Lines of each kind in an .obj file, to reserve storage before parsing.*/
+    struct LineCounts {
+        size_t vertices = 0, textures = 0, normals = 0, faces = 0;
+        /** Bytes of the face lines after `f`.*/
+        size_t faceBytes = 0;
+    };
+    
+    /** Count the `v`, `vt`, `vn` and `f` lines of a file in one quick pass over its bytes.*/
+    static LineCounts countLines(const std::string &fileName) {
+        LineCounts counts;
+        std::ifstream file(fileName, std::ios::binary);
+        std::vector<char> buffer(1 << 20);
+        // 0: line start, 1: after `v`, 2: after `f`, 3: rest of a face line, 4: rest of another line.
+        int state = 0;
+        while (file) {
+            file.read(buffer.data(), std::streamsize(buffer.size()));
+            const char *p = buffer.data(), *end = p + file.gcount();
+            while (p < end) {
+                if (state >= 3) {
+                    const char *eol = static_cast<const char *>(std::memchr(p, '\n', size_t(end - p)));
+                    if (state == 3) counts.faceBytes += size_t((eol ? eol : end) - p);
+                    if (eol == nullptr) break;
+                    p = eol + 1;
+                    state = 0;
+                    continue;
+                }
+                const char c = *p++;
+                if (c == '\n') state = 0;
+                else if (state == 0) state = c == 'v' ? 1 : c == 'f' ? 2 : c == ' ' || c == '\t' ? 0 : 4;
+                else if (state == 1) {
+                    if (c == ' ' || c == '\t') counts.vertices++;
+                    else if (c == 't') counts.textures++;
+                    else if (c == 'n') counts.normals++;
+                    state = 4;
+                } else if (c == ' ' || c == '\t') {
+                    counts.faces++;
+                    state = 3;
+                } else state = 4;
+            }
+        }
+        return counts;
+    }
+    
+    /** Parse a float in [p, end) after spaces and tabs, always with `.` as the decimal point: `strtof` follows the C locale, which an application may have set to one with `,`.
+     
+     - Returns: The position after the number, or `p` and 0 if there is none.
+     */
+    static const char *parseFloat(const char *p, const char *end, float &value) {
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        value = 0;
+#if defined(__cpp_lib_to_chars)
+        // from_chars does not take a leading '+'.
+        const char *start = p + 1 < end && *p == '+' && (std::isdigit(static_cast<unsigned char>(p[1])) || p[1] == '.') ? p + 1 : p;
+        std::from_chars_result r = std::from_chars(start, end, value);
+        if (r.ec == std::errc::result_out_of_range) {
+            // Infinity or 0, as `strtof` gives.
+            double d = 0;
+            std::from_chars(start, end, d);
+            value = float(d);
+        }
+        return r.ec == std::errc::invalid_argument ? p : r.ptr;
+#else
+        // The line or chunk is null terminated, as `strtof` needs.
+        char *next;
+#ifdef _MSC_VER
+        static const _locale_t c = _create_locale(LC_ALL, "C");
+        value = _strtof_l(p, &next, c);
+#else
+        static const locale_t c = newlocale(LC_ALL_MASK, "C", locale_t(0));
+        value = strtof_l(p, &next, c);
+#endif
+        return next;
+#endif
+    }
+    
+    /** Find the next `v/vt/vn` or `v//vn` corner in [p, end) and set its 0-based indices. Corners without a normal index are skipped.
+     
+     - Returns: The position after the corner, or nullptr if there is none.
+     */
+    static const char *nextCorner(const char *p, const char *end, GLuint &vertex, GLuint &normal) {
+        auto isDigit = [](const char c) { return c >= '0' && c <= '9'; };
+        while (p < end) {
+            if (!isDigit(*p)) {
+                p++;
+                continue;
+            }
+            GLuint v = 0;
+            while (p < end && isDigit(*p)) v = v * 10 + GLuint(*p++ - '0');
+            if (p == end || *p != '/') continue;
+            const char *q = p + 1;
+            while (q < end && isDigit(*q)) q++; // texture coordinate, unused
+            if (q == end || *q != '/' || q + 1 == end || !isDigit(q[1])) continue;
+            GLuint n = 0;
+            for (q++; q < end && isDigit(*q); q++) n = n * 10 + GLuint(*q - '0');
+            vertex = v - 1;
+            normal = n - 1;
+            return q;
+        }
+        return nullptr;
+    }
+    
+    /** Bounds of no vertices, with the sentinels the serial loops used.*/
+    static AABB emptyBounds() { return AABB(glm::vec3(987654321), glm::vec3(-987654321)); }
+    
+    static AABB mergeBounds(AABB a, const AABB &b) {
+        a.expand(b);
+        return a;
+    }
+    
     void generateBuffers() {
-        glGenVertexArrays(1, &vao);
+        const size_t vertexBytes = nVertices * sizeof(glm::vec3);
+        const size_t normalBytes = nSyncedNormals * sizeof(glm::vec3);
+        const size_t elementBytes = nElements3 * sizeof(glm::uvec3);
+        GPUMemory::get().reserve(vertexBytes + normalBytes + elementBytes, this);
+        const std::string owner = objFile.empty() ? "(generated)" : prefix + objFile;
+        
+        vao.generate(GPUMemory::VertexArray);
         glBindVertexArray(vao);
+        glLabel(GL_VERTEX_ARRAY, vao, owner);
         
-        glGenBuffers(1, &vertexBuffer);
+        vertexBuffer.generate(GPUMemory::Buffer);
         glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glLabel(GL_BUFFER, vertexBuffer, owner + " vertices");
         glBufferData(GL_ARRAY_BUFFER,
                      nVertices * sizeof(glm::vec3),
                      vertices.data(),
                      GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
+        vertexBuffer.track(vertexBytes, "mesh", owner);
         
-        glGenBuffers(1, &syncedNormalBuffer);
+        syncedNormalBuffer.generate(GPUMemory::Buffer);
         glBindBuffer(GL_ARRAY_BUFFER, syncedNormalBuffer);
+        glLabel(GL_BUFFER, syncedNormalBuffer, owner + " normals");
         glBufferData(GL_ARRAY_BUFFER,
                      nSyncedNormals * sizeof(glm::vec3),
                      syncedNormals.data(),
                      GL_STATIC_DRAW);
         glEnableVertexAttribArray(1);
         glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
+        syncedNormalBuffer.track(normalBytes, "mesh", owner);
         
-        glGenBuffers(1, &element3Buffer);
+        element3Buffer.generate(GPUMemory::Buffer);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element3Buffer);
+        glLabel(GL_BUFFER, element3Buffer, owner + " elements");
         glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                     nElements3 * sizeof(glm::vec3),
+                     nElements3 * sizeof(glm::uvec3),
                      elements3.data(),
                      GL_STATIC_DRAW);
+        element3Buffer.track(elementBytes, "mesh", owner);
+        
+        dirtyVertices.clear();
+        dirtyNormals.clear();
+        dirtyElements.clear();
+        makeResident([](GPUResident &mesh) { static_cast<ObjData &>(mesh).cleanupBuffers(); });
+        if (!keepCPUData) releaseCPUData();
+    }
+    
+    /** Mark `count` vertices from `first` as edited, for the next `syncBuffers`.*/
+    void markVerticesDirty(const size_t first, const size_t count) { dirtyVertices.add(first, first + count); }
+    /** Mark `count` entries of `syncedNormals` from `first` as edited.*/
+    void markNormalsDirty(const size_t first, const size_t count) { dirtyNormals.add(first, first + count); }
+    /** Mark `count` triangles of `elements3` from `first` as edited.*/
+    void markElementsDirty(const size_t first, const size_t count) { dirtyElements.add(first, first + count); }
+    
+    /** Upload CPU edits to the GPU buffers: only the marked ranges, plus anything appended to `vertices`, `syncedNormals` or `elements3` since the last upload.
+     
+     Small edits go up with `glBufferSubData` per range. When more than `orphanFraction` of a buffer changed, the buffer is orphaned(re-specified with no data, so the driver need not wait for draws still reading it) and uploaded whole. A buffer that is too small is re-specified `growth` times larger; it keeps its name, so the VAO stays valid. `adjustCenter` and the normal passes mark their edits themselves.
+     
+     - Returns: Bytes uploaded.
+     */
+    size_t syncBuffers() {
+        if (vao == 0) return 0; // not on the GPU yet; `generateBuffers` uploads everything
+        if (evicted) {
+            restoreBuffers();
+            return 0;
+        }
+        if (vertices.empty() && nVertices > 0) {
+            std::cerr << "Error on ObjData::syncBuffers: the CPU data of " << prefix + objFile << " was released or streamed, nothing to sync." << std::endl;
+            return 0;
+        }
+        // Appends. Triangles can also be removed; normals only grow(`MeshCompute` may have made more on the GPU).
+        if (vertices.size() > nVertices) dirtyVertices.add(nVertices, vertices.size());
+        if (syncedNormals.size() > nSyncedNormals) dirtyNormals.add(nSyncedNormals, syncedNormals.size());
+        if (elements3.size() > nElements3) dirtyElements.add(nElements3, elements3.size());
+        nVertices = GLuint(vertices.size());
+        nSyncedNormals = std::max(nSyncedNormals, GLuint(syncedNormals.size()));
+        nElements3 = GLuint(elements3.size());
+        
+        const std::string owner = objFile.empty() ? "(generated)" : prefix + objFile;
+        size_t bytes = syncBuffer(vertexBuffer, vertices, dirtyVertices, owner);
+        bytes += syncBuffer(syncedNormalBuffer, syncedNormals, dirtyNormals, owner);
+        bytes += syncBuffer(element3Buffer, elements3, dirtyElements, owner);
+        return bytes;
+    }
+    
+    /** Free the CPU geometry(`vertices`, `textures`, `normals`, `syncedNormals`, `elements3`, `elements4`). Counts, bounds, submeshes and materials stay.
+     
+     Drawing only needs the GPU buffers; if `GPUMemory` evicts them, `restoreBuffers` reads the file again. Generated meshes have no file to reload, so they keep their data.
+     */
+    void releaseCPUData() {
+        if (objFile.empty()) {
+            std::cerr << "Error on ObjData::releaseCPUData: a generated mesh can not be reloaded, keeping its data." << std::endl;
+            return;
+        }
+        // swap, not clear: clear keeps the capacity.
+        std::vector<glm::vec3>().swap(vertices);
+        std::vector<glm::vec2>().swap(textures);
+        std::vector<glm::vec3>().swap(normals);
+        std::vector<glm::vec3>().swap(syncedNormals);
+        std::vector<glm::uvec3>().swap(elements3);
+        std::vector<glm::uvec4>().swap(elements4);
+    }
+    
+    /** Delete the GPU buffers. CPU data is kept, so `generateBuffers` can upload it again.*/
+    void cleanupBuffers() {
+        rawNormalBuffer.reset();
+        element3Buffer.reset();
+        syncedNormalBuffer.reset();
+        vertexBuffer.reset();
+        vao.reset();
+        releaseResidency();
     }
     
+    /** Upload the mesh again after `GPUMemory` evicted it. Reloads the file when the CPU data is gone.*/
+    void restoreBuffers();
+    
+    /** Move vertices so the bounding box is centered at the origin. Bounds follow, so calling it again does nothing. `syncBuffers` uploads the moved vertices.*/
     void adjustCenter() {
-        for(int i = 0; i < vertices.size(); i++)
-            vertices[i] -= center;
+        const glm::vec3 shift = center;
+        ThreadPool::get().parallelFor(vertices.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) vertices[i] -= shift;
+        });
+        markVerticesDirty(0, vertices.size());
+        adjustCenterBounds();
+    }
+    
+    /** Upload the `dirty` ranges of `data` to `buffer`. See `syncBuffers`.*/
+    template <typename T>
+    size_t syncBuffer(GLName &buffer, const std::vector<T> &data, DirtyRanges &dirty, const std::string &owner) {
+        if (dirty.empty()) return 0;
+        // The copy target, not GL_ELEMENT_ARRAY_BUFFER: binding that would change the bound VAO.
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        GLint64 capacity = 0;
+        glGetBufferParameteri64v(GL_COPY_WRITE_BUFFER, GL_BUFFER_SIZE, &capacity);
+        const size_t used = data.size() * sizeof(T);
+        size_t bytes = 0;
+        if (used > size_t(capacity)) {
+            const size_t grown = std::max(used, size_t(double(used) * growth));
+            GPUMemory::get().reserve(grown - size_t(capacity), this);
+            glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(grown), nullptr, GL_DYNAMIC_DRAW);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, 0, GLsizeiptr(used), data.data());
+            buffer.track(grown, "mesh", owner);
+            bytes = used;
+        } else if (double(dirty.size()) > orphanFraction * double(data.size())) {
+            glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(capacity), nullptr, GL_DYNAMIC_DRAW);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, 0, GLsizeiptr(used), data.data());
+            bytes = used;
+        } else {
+            for (auto &r : dirty.ranges) {
+                const size_t last = std::min(r.second, data.size());
+                if (r.first >= last) continue;
+                glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(r.first * sizeof(T)), GLsizeiptr((last - r.first) * sizeof(T)), data.data() + r.first);
+                bytes += (last - r.first) * sizeof(T);
+            }
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        YGL_GL_COUNT(bufferBinds, 2);
+        dirty.clear();
+        return bytes;
+    }
+    
+    /** The bounds part of `adjustCenter`, for vertices moved elsewhere(`MeshCompute::recenter`).*/
+    void adjustCenterBounds() {
+        maxPos -= center;
+        minPos -= center;
+        for (auto &s : submeshes) {
+            s.minPos -= center;
+            s.maxPos -= center;
+        }
+        centerShift += center;
+        center = glm::vec3(0);
     }
     
     void render() {
-        glBindVertexArray(vao);
+        bind();
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element3Buffer);
+        YGL_GL_COUNT(bufferBinds, 1);
+        draw(0, nElements3 * 3);
+    }
+    
+    void renderSubmesh(const size_t i) {
+        bind();
+        draw(submeshes[i].first, submeshes[i].count);
+    }
+    
+    /** Draw the submeshes listed in `which`(e.g. the visible ones) with one `glMultiDrawElements` call.*/
+    void renderSubmeshes(const std::vector<GLuint> &which) {
+        if (which.empty()) return;
+        std::vector<GLsizei> counts(which.size());
+        std::vector<const void *> offsets(which.size());
+        GLsizei total = 0;
+        for (size_t i = 0; i < which.size(); i++) {
+            const Submesh &s = submeshes[which[i]];
+            counts[i] = GLsizei(s.count);
+            offsets[i] = reinterpret_cast<const void *>(size_t(s.first) * sizeof(GLuint));
+            total += counts[i];
+        }
+        bind();
+        glMultiDrawElements(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(), GLsizei(which.size()));
+        YGL_GL_COUNT(drawCalls, 1);
+        YGL_GL_COUNT(drawnVertices, total);
+    }
+    
+    /** Bind the VAO for `draw`, uploading the buffers again first if they were evicted.*/
+    void bind() {
+        if (evicted) restoreBuffers();
+        touchResident();
+        glBindVertexArray(vao);
+        YGL_GL_COUNT(vertexArrayBinds, 1);
+    }
+    
+    /** Draw `count` indices starting at index `first`. Call `bind` first; consecutive draws of one mesh need only one `bind`.*/
+    void draw(const GLuint first, const GLuint count) const {
+        glDrawElements(GL_TRIANGLES, GLsizei(count), GL_UNSIGNED_INT, reinterpret_cast<const void *>(size_t(first) * sizeof(GLuint)));
+        YGL_GL_COUNT(drawCalls, 1);
+        YGL_GL_COUNT(drawnVertices, count);
+    }
+};
+
+/** Loads an OBJ file into an `ObjData`'s GPU buffers a chunk at a time.
+ 
+ Each `next` call parses about `chunkBytes` of the file and appends its vertices, normals and triangles to GPU buffers that grow as needed. `ObjData::render` draws the triangles loaded so far. No geometry is kept on the CPU, so memory use follows the chunk size, not the file size.
+ 
+ A vertex's normal is the `vn` of the last face corner that used it(`loadObject` averages them instead, which is the same for the usual one normal per vertex). Faces with more than 3 corners are split into triangle fans. Texture coordinates are skipped. Submeshes are runs of faces in file order(a group that comes back starts another submesh), with the whole mesh's bounds.
+ 
+ ```
+ ObjStream stream;
+ stream.open(obj, "scan.obj");
+ // every frame:
+ stream.next();
+ obj.render();
+ ```
+ The `ObjData` must stay at the same address until the stream is done.
+ */
+struct ObjStream {
+    /** Start loading `objFileName`(relative to `obj.prefix`), replacing the mesh's GPU buffers.*/
+    bool open(ObjData &obj, const std::string &objFileName, const size_t chunkBytes = 4 << 20) {
+        this->obj = &obj;
+        this->chunkBytes = std::max<size_t>(chunkBytes, 4096);
+        
+        file.close();
+        file.clear();
+        file.open(obj.prefix + objFileName, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "No .obj file" << std::endl;
+            this->obj = nullptr;
+            return false;
+        }
+        file.seekg(0, std::ios::end);
+        fileSize = size_t(file.tellg());
+        file.seekg(0, std::ios::beg);
+        bytesRead = 0;
+        carry.clear();
+        
+        obj.cleanupBuffers();
+        obj.isOk = false;
+        obj.objFile = objFileName;
+        obj.streamChunkBytes = this->chunkBytes;
+        obj.submeshes.clear();
+        group.clear();
+        newSubmesh = true;
+        obj.nVertices = obj.nNormals = obj.nSyncedNormals = obj.nElements3 = obj.nElements4 = 0;
+        obj.maxPos = glm::vec3(-987654321);
+        obj.minPos = glm::vec3( 987654321);
+        vertexCapacity = syncedCapacity = normalCapacity = elementCapacity = 0;
+        
+        obj.vao.generate(GPUMemory::VertexArray);
+        obj.vertexBuffer.generate(GPUMemory::Buffer);
+        obj.syncedNormalBuffer.generate(GPUMemory::Buffer);
+        obj.rawNormalBuffer.generate(GPUMemory::Buffer);
+        obj.element3Buffer.generate(GPUMemory::Buffer);
+        bindAttributes();
+        return true;
+    }
+    
+    /** Parse and upload the next chunk.
+     
+     - Returns: false once the whole file is loaded(or loading failed).
+     */
+    bool next() {
+        if (obj == nullptr) return false;
+        
+        std::string chunk;
+        chunk.swap(carry);
+        size_t start = chunk.size();
+        chunk.resize(start + chunkBytes);
+        file.read(&chunk[start], std::streamsize(chunkBytes));
+        size_t got = size_t(file.gcount());
+        chunk.resize(start + got);
+        bytesRead += got;
+        const bool last = got < chunkBytes;
+        
+        // Keep the unfinished last line for the next chunk.
+        if (!last) {
+            size_t end = chunk.rfind('\n');
+            if (end == std::string::npos) end = 0;
+            else end++;
+            carry.assign(chunk, end, std::string::npos);
+            chunk.resize(end);
+        }
+        
+        parse(chunk);
+        upload();
+        
+        if (last) finish();
+        return !last;
+    }
+    
+    bool done() const { return obj == nullptr; }
+    
+    /** Fraction of the file read so far.*/
+    float progress() const { return fileSize ? float(bytesRead) / float(fileSize) : 1.f; }
+    
+private:
+    void parse(const std::string &chunk) {
+        const char *p = chunk.c_str();
+        const char *end = p + chunk.size();
+        while (p < end) {
+            const char *eol = static_cast<const char *>(std::memchr(p, '\n', size_t(end - p)));
+            if (eol == nullptr) eol = end;
+            parseLine(p, eol);
+            p = eol + 1;
+        }
+    }
+    
+    void parseLine(const char *p, const char *eol) {
+        while (p < eol && (*p == ' ' || *p == '\t')) p++;
+        if (p + 1 >= eol) return;
+        
+        if (p[0] == 'v' && p[1] == ' ') {
+            float x, y, z;
+            ObjData::parseFloat(ObjData::parseFloat(ObjData::parseFloat(p + 2, eol, x), eol, y), eol, z);
+            vertices.push_back({x, y, z});
+        } else if (p[0] == 'v' && p[1] == 'n') {
+            float x, y, z;
+            ObjData::parseFloat(ObjData::parseFloat(ObjData::parseFloat(p + 2, eol, x), eol, y), eol, z);
+            normals.push_back({x, y, z});
+        } else if (p[0] == 'f' && p[1] == ' ') {
+            parseFace(p + 2, eol);
+        } else if (std::strncmp(p, "mtllib ", 7) == 0) {
+            std::string name = trimmed(p + 7, eol);
+            obj->materialFile = name;
+            obj->loadMtl(name);
+        } else if (std::strncmp(p, "usemtl ", 7) == 0) {
+            obj->material = trimmed(p + 7, eol);
+            newSubmesh = true;
+        } else if ((p[0] == 'o' || p[0] == 'g') && (p[1] == ' ' || p[1] == '\t')) {
+            group = trimmed(p + 2, eol);
+            newSubmesh = true;
+        }
+    }
+    
+    void parseFace(const char *p, const char *eol) {
+        // OBJ indices start at 1; negative ones count back from the latest element.
+        const long nV = long(obj->nVertices + vertices.size());
+        const long nN = long(obj->nNormals + normals.size());
+        polygon.clear();
+        while (p < eol) {
+            char *next;
+            long v = std::strtol(p, &next, 10);
+            if (next == p) break;
+            p = next;
+            long n = 0;
+            if (*p == '/') {
+                p++;
+                if (*p != '/') {
+                    std::strtol(p, &next, 10); // texture coordinate, unused
+                    p = next;
+                }
+                if (*p == '/') {
+                    p++;
+                    n = std::strtol(p, &next, 10);
+                    p = next;
+                }
+            }
+            GLuint vertex = GLuint(v < 0 ? nV + v : v - 1);
+            polygon.push_back(vertex);
+            if (n != 0) corners.push_back({vertex, GLuint(n < 0 ? nN + n : n - 1)});
+            while (p < eol && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+        }
+        if (polygon.size() < 3) return;
+        
+        if (newSubmesh) {
+            auto &submeshes = obj->submeshes;
+            if (submeshes.empty() || submeshes.back().name != group || submeshes.back().material != obj->material) {
+                ObjData::Submesh s;
+                s.name = group;
+                s.material = obj->material;
+                s.first = GLuint(obj->nElements3 + triangles.size()) * 3;
+                submeshes.push_back(s);
+            }
+            newSubmesh = false;
+        }
+        obj->submeshes.back().count += GLuint(polygon.size() - 2) * 3;
+        for (size_t i = 2; i < polygon.size(); i++)
+            triangles.push_back({polygon[0], polygon[i - 1], polygon[i]});
+    }
+    
+    static std::string trimmed(const char *p, const char *eol) {
+        std::string s(p, eol);
+        while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) s.pop_back();
+        return s;
+    }
+    
+    void upload() {
+        if (!vertices.empty()) {
+            const size_t offset = obj->nVertices * sizeof(glm::vec3);
+            const size_t bytes = vertices.size() * sizeof(glm::vec3);
+            bool grew = grow(obj->vertexBuffer, offset, vertexCapacity, offset + bytes);
+            // One normal per vertex, filled from the raw normals in copyNormals.
+            if (grew) growTo(obj->syncedNormalBuffer, offset, syncedCapacity, vertexCapacity);
+            glBindBuffer(GL_ARRAY_BUFFER, obj->vertexBuffer);
+            glBufferSubData(GL_ARRAY_BUFFER, GLintptr(offset), GLsizeiptr(bytes), vertices.data());
+            for (auto &v : vertices) {
+                obj->minPos = glm::min(obj->minPos, v);
+                obj->maxPos = glm::max(obj->maxPos, v);
+            }
+            obj->nVertices += GLuint(vertices.size());
+            if (grew) bindAttributes();
+        }
+        
+        if (!normals.empty()) {
+            const size_t offset = obj->nNormals * sizeof(glm::vec3);
+            const size_t bytes = normals.size() * sizeof(glm::vec3);
+            bool grew = grow(obj->rawNormalBuffer, offset, normalCapacity, offset + bytes);
+            glBindBuffer(GL_ARRAY_BUFFER, obj->rawNormalBuffer);
+            if (grew) glLabel(GL_BUFFER, obj->rawNormalBuffer, obj->prefix + obj->objFile + " raw normals");
+            glBufferSubData(GL_ARRAY_BUFFER, GLintptr(offset), GLsizeiptr(bytes), normals.data());
+            obj->nNormals += GLuint(normals.size());
+        }
         
-        glDrawElements(GL_TRIANGLES, nElements3 * 3, GL_UNSIGNED_SHORT, 0);
+        if (!corners.empty()) copyNormals();
+        
+        if (!triangles.empty()) {
+            const size_t offset = obj->nElements3 * sizeof(glm::uvec3);
+            const size_t bytes = triangles.size() * sizeof(glm::uvec3);
+            if (grow(obj->element3Buffer, offset, elementCapacity, offset + bytes)) bindAttributes();
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, obj->element3Buffer);
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, GLintptr(offset), GLsizeiptr(bytes), triangles.data());
+            obj->nElements3 += GLuint(triangles.size());
+        }
+        
+        obj->nSyncedNormals = obj->nVertices;
+        obj->center = (obj->maxPos + obj->minPos) * 0.5f;
+        obj->scale = obj->maxPos - obj->minPos;
+        trackMemory();
+        
+        vertices.clear();
+        normals.clear();
+        corners.clear();
+        triangles.clear();
+    }
+    
+    /** Copy each corner's raw normal to its vertex, on the GPU. Runs of consecutive vertex and normal indices(the usual `f v//v` layout) become one copy.*/
+    void copyNormals() {
+        // Last corner wins: stable sort by vertex, then keep the last of each vertex.
+        std::stable_sort(corners.begin(), corners.end(),
+                         [](const glm::uvec2 &a, const glm::uvec2 &b) { return a.x < b.x; });
+        glBindBuffer(GL_COPY_READ_BUFFER, obj->rawNormalBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, obj->syncedNormalBuffer);
+        
+        const size_t stride = sizeof(glm::vec3);
+        size_t i = 0;
+        while (i < corners.size()) {
+            // Start of a run: the last corner of this vertex.
+            while (i + 1 < corners.size() && corners[i + 1].x == corners[i].x) i++;
+            GLuint v0 = corners[i].x, n0 = corners[i].y, count = 1;
+            i++;
+            while (i < corners.size()) {
+                size_t j = i;
+                while (j + 1 < corners.size() && corners[j + 1].x == corners[j].x) j++;
+                if (corners[j].x != v0 + count || corners[j].y != n0 + count) break;
+                count++;
+                i = j + 1;
+            }
+            if (v0 >= obj->nVertices) continue;
+            // A run can reach past the last vertex when faces name vertices not read yet.
+            count = std::min(count, obj->nVertices - v0);
+            if (n0 + count > obj->nNormals) continue;
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                                GLintptr(n0 * stride), GLintptr(v0 * stride), GLsizeiptr(count * stride));
+        }
+    }
+    
+    /** Grow `buffer` to hold `needed` bytes, keeping the first `used` bytes. Capacity doubles to keep copies rare.
+     
+     - Returns: true if the buffer was replaced.
+     */
+    bool grow(GLName &buffer, const size_t used, size_t &capacity, const size_t needed) {
+        if (needed <= capacity) return false;
+        growTo(buffer, used, capacity, std::max({needed, capacity * 2, size_t(1) << 16}));
+        return true;
+    }
+    
+    void growTo(GLName &buffer, const size_t used, size_t &capacity, const size_t newCapacity) {
+        GPUMemory::get().reserve(newCapacity - capacity, obj);
+        GLName bigger;
+        bigger.generate(GPUMemory::Buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, bigger);
+        glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(newCapacity), nullptr, GL_STATIC_DRAW);
+        if (used > 0 && buffer != 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, GLsizeiptr(used));
+        }
+        buffer = std::move(bigger);
+        capacity = newCapacity;
+    }
+    
+    /** Point the VAO at the current buffers, and label them: `grow` replaces buffers, and open() creates them.*/
+    void bindAttributes() {
+        const std::string owner = obj->prefix + obj->objFile;
+        glBindVertexArray(obj->vao);
+        glLabel(GL_VERTEX_ARRAY, obj->vao, owner);
+        glBindBuffer(GL_ARRAY_BUFFER, obj->vertexBuffer);
+        glLabel(GL_BUFFER, obj->vertexBuffer, owner + " vertices");
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
+        glBindBuffer(GL_ARRAY_BUFFER, obj->syncedNormalBuffer);
+        glLabel(GL_BUFFER, obj->syncedNormalBuffer, owner + " normals");
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, obj->element3Buffer);
+        glLabel(GL_BUFFER, obj->element3Buffer, owner + " elements");
+        glBindVertexArray(0);
+    }
+    
+    void trackMemory() {
+        const std::string owner = obj->prefix + obj->objFile;
+        obj->vertexBuffer.track(vertexCapacity, "mesh", owner);
+        obj->syncedNormalBuffer.track(syncedCapacity, "mesh", owner);
+        obj->rawNormalBuffer.track(normalCapacity, "mesh", owner);
+        obj->element3Buffer.track(elementCapacity, "mesh", owner);
+    }
+    
+    void finish() {
+        file.close();
+        obj->isOk = true;
+        // Vertices are not kept, so submeshes get the mesh's bounds.
+        for (auto &s : obj->submeshes) {
+            s.minPos = obj->minPos;
+            s.maxPos = obj->maxPos;
+        }
+        // Evictable only once complete; `restoreBuffers` streams the file again.
+        obj->makeResident([](GPUResident &mesh) { static_cast<ObjData &>(mesh).cleanupBuffers(); });
+        std::cout << "--- Wavefront Object Streamed: " << obj->nVertices << " vertices, "
+                  << obj->nElements3 << " triangles ---" << std::endl;
+        obj = nullptr;
     }
+    
+    ObjData *obj = nullptr;
+    std::ifstream file;
+    size_t chunkBytes = 4 << 20;
+    size_t fileSize = 0;
+    size_t bytesRead = 0;
+    std::string carry;
+    std::string group;
+    bool newSubmesh = true;
+    
+    size_t vertexCapacity = 0, syncedCapacity = 0, normalCapacity = 0, elementCapacity = 0;
+    
+    // Geometry of the current chunk only.
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::uvec2> corners;
+    std::vector<glm::uvec3> triangles;
+    std::vector<GLuint> polygon;
 };
+
+inline void ObjData::restoreBuffers() {
+    if (streamChunkBytes > 0 && vertices.empty()) {
+        std::cout << "Stream evicted " << prefix + objFile << std::endl;
+        ObjStream stream;
+        if (stream.open(*this, objFile, streamChunkBytes))
+            while (stream.next()) {}
+        return;
+    }
+    if (vertices.empty() && !objFile.empty()) {
+        std::cout << "Reload evicted " << prefix + objFile << std::endl;
+        vertices.clear(); textures.clear(); normals.clear(); syncedNormals.clear();
+        elements3.clear(); elements4.clear(); materialData.clear();
+        const glm::vec3 shift = centerShift;
+        centerShift = glm::vec3(0);
+        loadObject(objFile);
+        if (!isOk) return;
+        if (shift != glm::vec3(0)) {
+            center = shift;
+            adjustCenter();
+        }
+    }
+    generateBuffers();
+}
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <framebuffer.hpp>
+#include <program.hpp>
+#include <error.hpp>
+#include <glstats.hpp>
+
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/** One effect of a `PostChain`.
+
+ `glsl` declares the stage's uniforms and a function named `name`:
+
+ - per-pixel stages: `vec4 name(vec4 color, vec2 uv)`, from the color of this pixel so far.
+ - stages with `samplesNeighbors`: `vec4 name(sampler2D source, vec2 uv)`, free to sample the input anywhere(blur, FXAA, ...).
+
+ ```
+ PostStage exposure{"exposure", R"(
+ uniform float exposureScale;
+ vec4 exposure(vec4 color, vec2 uv) { return vec4(color.rgb * exposureScale, color.a); }
+ )", [&](Program &p) { p.setUniform("exposureScale", scale); }};
+ ```
+ Stages share one shader when fused, so uniform and helper names must be unique within the chain; prefix them with the stage name.
+ */
+struct PostStage {
+    std::string name;
+    std::string glsl;
+    /** Set the stage's uniforms. Called with the pass's program in use, every `render`.*/
+    std::function<void(Program &)> setUniforms;
+    /** Reads other pixels of its input, which must then be in a texture: starts a new pass unless it is first.*/
+    bool samplesNeighbors = false;
+    bool enabled = true;
+};
+
+/** Full-screen post-processing chain.
+
+ Consecutive per-pixel stages are fused into one generated shader, so the chain makes one full-screen pass for every stage that samples neighbors(plus one at the start when the first stage is per-pixel) instead of one per stage. Each pass draws a single attributeless triangle(`Framebuffer::renderFullscreen`) without clearing; passes before the last write `intermediateFormat` textures, the last writes the output.
+
+ ```
+ PostChain post;
+ post.add(bloom);    // samplesNeighbors
+ post.add(exposure);
+ post.add(toneMap);
+ post.add(vignette); // 1 pass: bloom, exposure, tone map and vignette in one shader
+ ...
+ scene.render(window, draw);
+ post.render(scene, screen);
+ ```
+ Shaders are generated when the set of enabled stages changes, and kept, so toggling a stage back does not recompile.
+ */
+struct PostChain {
+    std::vector<PostStage> stages;
+    /** Fuse per-pixel stages. Off gives every stage its own pass, e.g. to compare.*/
+    bool fuse = true;
+    /** Format of the textures between passes.*/
+    GLint intermediateFormat = GL_RGBA16F;
+
+    /** - Returns: Index of the stage, for `setEnabled`.*/
+    size_t add(const PostStage &stage) {
+        stages.push_back(stage);
+        dirty = true;
+        return stages.size() - 1;
+    }
+
+    void setEnabled(const size_t stage, const bool enabled) {
+        if (stages[stage].enabled == enabled) return;
+        stages[stage].enabled = enabled;
+        dirty = true;
+    }
+
+    void clear() {
+        stages.clear();
+        dirty = true;
+    }
+
+    /** Run the chain from a color attachment of `input` into `output`'s viewport.
+
+     Only `input`'s viewport is read, so it works with `DynamicResolution` framebuffers; the last pass scales it to `output`.
+
+     - Parameters:
+        - parameter input: Single-sampled framebuffer; `resolve` multisampled ones first.
+        - parameter output: Framebuffer to write, e.g. one made by `initDefault` for the window.
+        - parameter attachment: Index into `input.textureIDs`.
+     */
+    void render(Framebuffer &input, Framebuffer &output, const int attachment = 0) {
+        update();
+
+        GLboolean depthTestWasOn = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean blendWasOn = glIsEnabled(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        YGL_GL_COUNT(stateChanges, 2);
+
+        if (passes.size() > 1) allocateIntermediates(input);
+
+        GLuint source = input.textureIDs[attachment];
+        const glm::vec2 uvScale(float(input.viewportWidth) / float(input.width),
+                                float(input.viewportHeight) / float(input.height));
+        for (size_t i = 0; i < passes.size(); i++) {
+            const bool last = i + 1 == passes.size();
+            Framebuffer &target = last ? output : intermediates[i % 2];
+            Program &program = *passes[i]->program;
+
+            program.use();
+            program.setUniform("source", 0);
+            program.setUniform("uvScale", uvScale);
+            program.setUniform("viewportSize", glm::vec2(target.viewportWidth, target.viewportHeight));
+            for (size_t s : passes[i]->stages)
+                if (stages[s].setUniforms) stages[s].setUniforms(program);
+
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, source);
+            YGL_GL_COUNT(textureBinds, 1);
+
+            target.renderFullscreen();
+            source = target.id != 0 && !target.textureIDs.empty() ? target.textureIDs[0] : 0;
+        }
+
+        if (depthTestWasOn) glEnable(GL_DEPTH_TEST);
+        if (blendWasOn) glEnable(GL_BLEND);
+        glErr("Error on PostChain::render()");
+    }
+
+    /** Full-screen passes `render` makes with the current stages.*/
+    size_t passCount() {
+        update();
+        return passes.size();
+    }
+
+    /** Generated fragment shader of pass `i`, for reading compile errors.*/
+    std::string fragmentSource(const size_t i) {
+        update();
+        return passes[i]->source;
+    }
+
+    /** Delete generated programs and intermediate textures.*/
+    void cleanup() {
+        passes.clear();
+        programs.clear();
+        for (auto &f : intermediates) f.cleanup();
+        dirty = true;
+    }
+
+private:
+    struct Pass {
+        std::vector<size_t> stages;
+        std::string source;
+        Program *program = nullptr;
+    };
+
+    bool dirty = true;
+    /** `fuse` when the passes were built.*/
+    bool builtFuse = true;
+    std::vector<std::unique_ptr<Pass>> passes;
+    /** Programs by fragment source.*/
+    std::map<std::string, std::unique_ptr<Program>> programs;
+    /** Ping-pong targets of multi-pass chains, the size of the input.*/
+    Framebuffer intermediates[2];
+
+    void update() {
+        if (dirty || fuse != builtFuse) build();
+    }
+
+    /** Split the enabled stages into passes and generate their shaders.*/
+    void build() {
+        passes.clear();
+        for (size_t s = 0; s < stages.size(); s++) {
+            if (!stages[s].enabled) continue;
+            // A pass can start with a neighbor-sampling stage, which reads the pass's source texture.
+            bool newPass = passes.empty() || !fuse || stages[s].samplesNeighbors;
+            if (newPass) passes.push_back(std::make_unique<Pass>());
+            passes.back()->stages.push_back(s);
+        }
+        // Nothing enabled: copy.
+        if (passes.empty()) passes.push_back(std::make_unique<Pass>());
+
+        for (auto &pass : passes) {
+            pass->source = generate(pass->stages);
+            std::unique_ptr<Program> &program = programs[pass->source];
+            if (!program) {
+                program = std::make_unique<Program>();
+                program->loadShaderSource(Framebuffer::fullscreenVS, pass->source);
+            }
+            pass->program = program.get();
+        }
+        dirty = false;
+        builtFuse = fuse;
+    }
+
+    std::string generate(const std::vector<size_t> &passStages) const {
+        std::string text = "#version 410 core\n"
+                           "uniform sampler2D source;\n"
+                           "uniform vec2 uvScale;\n"
+                           "uniform vec2 viewportSize;\n"
+                           "out vec4 fragColor;\n";
+        for (size_t s : passStages) text += "\n// " + stages[s].name + "\n" + stages[s].glsl + "\n";
+
+        text += "\nvoid main() {\n"
+                "    vec2 uv = gl_FragCoord.xy / viewportSize * uvScale;\n";
+        size_t first = 0;
+        if (!passStages.empty() && stages[passStages[0]].samplesNeighbors) {
+            text += "    vec4 color = " + stages[passStages[0]].name + "(source, uv);\n";
+            first = 1;
+        } else {
+            text += "    vec4 color = texture(source, uv);\n";
+        }
+        for (size_t i = first; i < passStages.size(); i++)
+            text += "    color = " + stages[passStages[i]].name + "(color, uv);\n";
+        text += "    fragColor = color;\n"
+                "}\n";
+        return text;
+    }
+
+    void allocateIntermediates(const Framebuffer &input) {
+        for (auto &f : intermediates) {
+            if (f.id == 0 || f.width != input.width || f.height != input.height) {
+                f.init(input.width, input.height);
+                f.attachTexture2D(1, intermediateFormat);
+            }
+            // Same rendered region as the input, so `uvScale` holds for every pass.
+            f.setViewport(input.viewportWidth, input.viewportHeight);
+        }
+    }
+};
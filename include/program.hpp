@@ -4,6 +4,9 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <error.hpp>
+#include <glstats.hpp>
+
 #include <fstream>
 #include <iostream>
 
@@ -16,6 +19,7 @@ struct Program
     std::string fragShaderName = "";
     GLuint fragShaderID = 0;
     std::string geomShaderName = "";
+    std::string computeShaderName = "";
 
     std::string loadText(const char *filename)
     {
@@ -107,11 +111,43 @@ struct Program
         linkShader();
     }
     
-    void loadShaderOf(const char *shaderFile, const GLenum shaderType) {
-        std::string shaderName = std::string(shaderFile);
+    /** Build the program from shader source strings instead of files.*/
+    void loadShaderSource(const std::string &vShaderText, const std::string &fShaderText)
+    {
+        cleanUp();
+        
+        // Create Program
+        programID = glCreateProgram();
+        std::cout << "Program " << programID << " created" << std::endl;
+        
+        loadShaderTextOf(vShaderText, "<vertex source>", GL_VERTEX_SHADER);
+        loadShaderTextOf(fShaderText, "<fragment source>", GL_FRAGMENT_SHADER);
         
-        std::string shaderText = loadText(shaderFile);
+        linkShader();
+    }
+    
+    /** Build a compute program from source. Needs GL 4.3 or `ARB_compute_shader`.
+     
+     - Parameters:
+        - parameter name: Shown in compile errors and GL debug output.
+     */
+    void loadComputeSource(const std::string &cShaderText, const std::string &name = "<compute source>")
+    {
+        cleanUp();
         
+        programID = glCreateProgram();
+        std::cout << "Program " << programID << " created" << std::endl;
+        
+        loadShaderTextOf(cShaderText, name, GL_COMPUTE_SHADER);
+        
+        linkShader();
+    }
+    
+    void loadShaderOf(const char *shaderFile, const GLenum shaderType) {
+        loadShaderTextOf(loadText(shaderFile), shaderFile, shaderType);
+    }
+    
+    void loadShaderTextOf(const std::string &shaderText, const std::string &shaderName, const GLenum shaderType) {
         GLuint shaderID = glCreateShader(shaderType);
         
         // Read Shader File
@@ -120,6 +156,11 @@ struct Program
         const GLchar* shaderCode = shaderText.c_str();
         glShaderSource(shaderID, 1, &shaderCode, 0);
         glCompileShader(shaderID);
+        glLabel(GL_SHADER, shaderID, shaderName);
+        if (shaderType == GL_VERTEX_SHADER) vertexShaderName = shaderName;
+        else if (shaderType == GL_GEOMETRY_SHADER) geomShaderName = shaderName;
+        else if (shaderType == GL_FRAGMENT_SHADER) fragShaderName = shaderName;
+        else if (shaderType == GL_COMPUTE_SHADER) computeShaderName = shaderName;
         if(shaderCompileCheck(shaderID))
             glAttachShader(programID, shaderID);
         else {
@@ -128,6 +169,14 @@ struct Program
         }
     }
     
+    /** Name for GL debug output: the program ID and its shader names.*/
+    std::string label() const {
+        std::string text = "program " + std::to_string(programID) + ":";
+        for (const std::string *name : {&vertexShaderName, &geomShaderName, &fragShaderName, &computeShaderName})
+            if (!name->empty()) text += " " + *name;
+        return text;
+    }
+    
     void printLog()
     {
         GLint maxLength = 0;
@@ -158,41 +207,55 @@ struct Program
 
             return;
         }
+        glLabel(GL_PROGRAM, programID, label());
         glUseProgram(programID);
     }
     
     
     void setUniform(const char *uniformName, const glm::vec2 &value) {
+        YGL_GL_COUNT(uniformUpdates, 1);
         glUniform2fv(glGetUniformLocation(programID, uniformName),
                      1,
                      glm::value_ptr(value));
     }
     void setUniform(const char *uniformName, const glm::vec3 &value) {
+        YGL_GL_COUNT(uniformUpdates, 1);
         glUniform3fv(glGetUniformLocation(programID, uniformName),
                      1,
                      glm::value_ptr(value));
     }
     void setUniform(const char *uniformName, const glm::vec4 &value) {
+        YGL_GL_COUNT(uniformUpdates, 1);
         glUniform4fv(glGetUniformLocation(programID, uniformName),
                      1,
                      glm::value_ptr(value));
     }
     
     void setUniform(const char *uniformName, const bool &value) {
+        YGL_GL_COUNT(uniformUpdates, 1);
         glUniform1i(glGetUniformLocation(programID, uniformName),
                     value);
     }
     void setUniform(const char *uniformName, const int &value) {
+        YGL_GL_COUNT(uniformUpdates, 1);
         glUniform1i(glGetUniformLocation(programID, uniformName),
                     value);
     }
+    /** For `uint` uniforms. Not a `setUniform` overload, which would move unsigned arguments(e.g. texture units for samplers) off `glUniform1i`.*/
+    void setUniformUint(const char *uniformName, const GLuint value) {
+        YGL_GL_COUNT(uniformUpdates, 1);
+        glUniform1ui(glGetUniformLocation(programID, uniformName),
+                     value);
+    }
     
     void setUniform(const char *uniformName, const float &value) {
+        YGL_GL_COUNT(uniformUpdates, 1);
         glUniform1f(glGetUniformLocation(programID, uniformName),
                     value);
     }
     
     void setUniform(const char *uniformName, const glm::mat4 &value, bool transpose = GL_FALSE) {
+        YGL_GL_COUNT(uniformUpdates, 1);
         glUniformMatrix4fv(glGetUniformLocation(programID, uniformName),
                            1,
                            transpose,
@@ -200,6 +263,7 @@ struct Program
     }
     
     void setUniform(const char *uniformName, const glm::mat3 &value, bool transpose = GL_FALSE) {
+        YGL_GL_COUNT(uniformUpdates, 1);
         glUniformMatrix3fv(glGetUniformLocation(programID, uniformName),
                            1,
                            transpose,
@@ -211,11 +275,13 @@ struct Program
                                              GL_FRAGMENT_SHADER,
                                              subroutineName);
         glUniformSubroutinesuiv(GL_FRAGMENT_SHADER, 1, &subroutine);
+        YGL_GL_COUNT(uniformUpdates, 1);
 
     }
     
     void use() {
         glUseProgram(programID);
+        YGL_GL_COUNT(programBinds, 1);
     }
     
     void cleanUp()
@@ -232,6 +298,7 @@ struct Program
 
         // value reset
         programID = vertexShaderID = geomShaderID = fragShaderID = 0;
+        vertexShaderName = geomShaderName = fragShaderName = computeShaderName = "";
     }
     ~Program()
     {
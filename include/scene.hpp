@@ -0,0 +1,151 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+/** Transform hierarchy in structure-of-arrays form.
+
+ Nodes are kept in topological order(parents before children), so `update` computes all world matrices in one linear pass: a node is recomputed only when it or an ancestor changed since the last update.
+
+ Nodes are referred to by handles, which stay valid when reparenting reorders the arrays.
+ */
+struct TransformSystem {
+    typedef uint32_t Handle;
+    static constexpr uint32_t none = ~0u;
+
+    /** Add a node under `parent`(or a root). Starts at the identity transform.*/
+    Handle create(const Handle parent = none) {
+        Handle h = Handle(slotOf.size());
+        uint32_t slot = uint32_t(handleOf.size());
+        slotOf.push_back(slot);
+        handleOf.push_back(h);
+
+        // Appending keeps topological order: the parent already exists.
+        this->parent.push_back(parent == none ? none : slotOf[parent]);
+        position.push_back(glm::vec3(0));
+        rotation.push_back(glm::quat(1, 0, 0, 0));
+        scale.push_back(glm::vec3(1));
+        world.push_back(glm::mat4(1));
+        dirty.push_back(1);
+        return h;
+    }
+
+    void setPosition(const Handle h, const glm::vec3 &p) { position[slotOf[h]] = p; dirty[slotOf[h]] = 1; }
+    void setRotation(const Handle h, const glm::quat &r) { rotation[slotOf[h]] = r; dirty[slotOf[h]] = 1; }
+    void setScale   (const Handle h, const glm::vec3 &s) { scale[slotOf[h]] = s; dirty[slotOf[h]] = 1; }
+
+    const glm::vec3 &getPosition(const Handle h) const { return position[slotOf[h]]; }
+    const glm::quat &getRotation(const Handle h) const { return rotation[slotOf[h]]; }
+    const glm::vec3 &getScale   (const Handle h) const { return scale[slotOf[h]]; }
+
+    /** World matrix as of the last `update`.*/
+    const glm::mat4 &worldMatrix(const Handle h) const { return world[slotOf[h]]; }
+
+    Handle getParent(const Handle h) const {
+        uint32_t p = parent[slotOf[h]];
+        return p == none ? none : handleOf[p];
+    }
+
+    /** Move a node(with its subtree) under another parent. Reorders the arrays at the next `update` if needed.
+
+     - Returns: false, leaving the hierarchy unchanged, when `newParent` is `h` or one of its descendants.
+     */
+    bool setParent(const Handle h, const Handle newParent) {
+        // A cycle would never sort into topological order.
+        for (Handle a = newParent; a != none; a = getParent(a)) {
+            if (a == h) {
+                std::cerr << "Error on TransformSystem::setParent: node " << newParent << " is node " << h
+                          << " or one of its descendants." << std::endl;
+                return false;
+            }
+        }
+        uint32_t slot = slotOf[h];
+        parent[slot] = newParent == none ? none : slotOf[newParent];
+        dirty[slot] = 1;
+        if (parent[slot] != none && parent[slot] > slot) needsSort = true;
+        return true;
+    }
+
+    /** Recompute world matrices of changed nodes and their descendants.*/
+    void update() {
+        if (needsSort) sort();
+
+        const size_t n = parent.size();
+        for (size_t i = 0; i < n; i++) {
+            const uint32_t p = parent[i];
+            if (p != none) dirty[i] |= dirty[p];
+            if (!dirty[i]) continue;
+
+            glm::mat4 local = glm::mat4_cast(rotation[i]);
+            local[0] *= scale[i].x;
+            local[1] *= scale[i].y;
+            local[2] *= scale[i].z;
+            local[3] = glm::vec4(position[i], 1);
+            world[i] = p == none ? local : world[p] * local;
+        }
+        // Cleared after the pass, since children read their parent's flag.
+        std::fill(dirty.begin(), dirty.end(), 0);
+    }
+
+    size_t size() const { return parent.size(); }
+
+    // Arrays indexed by slot, parents first.
+    std::vector<uint32_t> parent;
+    std::vector<glm::vec3> position;
+    std::vector<glm::quat> rotation;
+    std::vector<glm::vec3> scale;
+    std::vector<glm::mat4> world;
+    std::vector<uint8_t> dirty;
+
+private:
+    /** Restore topological order: stable sort by depth.*/
+    void sort() {
+        const size_t n = parent.size();
+        std::vector<uint32_t> depth(n, none);
+        auto depthOf = [&](uint32_t i) {
+            // Walk up to a node with known depth, then fill the path back down.
+            std::vector<uint32_t> path;
+            while (i != none && depth[i] == none) {
+                path.push_back(i);
+                i = parent[i];
+            }
+            uint32_t d = i == none ? 0 : depth[i] + 1;
+            for (auto it = path.rbegin(); it != path.rend(); ++it) depth[*it] = d++;
+        };
+        for (uint32_t i = 0; i < n; i++) depthOf(i);
+
+        std::vector<uint32_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return depth[a] < depth[b]; });
+
+        std::vector<uint32_t> newSlot(n);
+        for (uint32_t i = 0; i < n; i++) newSlot[order[i]] = i;
+
+        auto permute = [&](auto &v) {
+            auto old = v;
+            for (uint32_t i = 0; i < n; i++) v[i] = old[order[i]];
+        };
+        permute(parent);
+        for (auto &p : parent)
+            if (p != none) p = newSlot[p];
+        permute(position);
+        permute(rotation);
+        permute(scale);
+        permute(world);
+        permute(dirty);
+        permute(handleOf);
+        for (uint32_t i = 0; i < n; i++) slotOf[handleOf[i]] = i;
+
+        needsSort = false;
+    }
+
+    std::vector<uint32_t> slotOf;
+    std::vector<Handle> handleOf;
+    bool needsSort = false;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <framebuffer.hpp> // stb_image implementation
+#include <glstats.hpp>
+#include <gpumemory.hpp>
+
+#include <iostream>
+#include <string>
+
+/** 2D RGBA8 texture loaded from an image file.
+
+ Counts against the `GPUMemory` budget as category "texture" and may be evicted when unused; `bind` loads it from the file again.
+ */
+struct Texture2D : GPUResident {
+    std::string fileName = "";
+    int width = 0;
+    int height = 0;
+    GLName id;
+
+    bool load(const std::string &fileName) {
+        this->fileName = fileName;
+        int channels;
+        stbi_set_flip_vertically_on_load(true);
+        unsigned char *data = stbi_load(fileName.c_str(), &width, &height, &channels, 4);
+        if (data == nullptr) {
+            std::cerr << "Texture <" << fileName << "> not found." << std::endl;
+            return false;
+        }
+
+        const size_t bytes = size_t(width) * height * 4;
+        GPUMemory::get().reserve(bytes, this);
+
+        id.generate(GPUMemory::Texture);
+        glBindTexture(GL_TEXTURE_2D, id);
+#ifdef __APPLE__
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+#else
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+#endif
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        stbi_image_free(data);
+
+        id.track(bytes, "texture", fileName);
+        glLabel(GL_TEXTURE, id, fileName);
+        makeResident([](GPUResident &texture) { static_cast<Texture2D &>(texture).id.reset(); });
+        return true;
+    }
+
+    /** Bind to texture unit `unit`, reloading first if the texture was evicted.*/
+    void bind(const int unit = 0) {
+        if (evicted && !load(fileName)) return;
+        touchResident();
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, id);
+        YGL_GL_COUNT(textureBinds, 1);
+    }
+
+    void cleanup() {
+        id.reset();
+        releaseResidency();
+    }
+};
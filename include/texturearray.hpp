@@ -0,0 +1,275 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <error.hpp>
+#include <framebuffer.hpp> // stb_image implementation
+#include <glstats.hpp>
+#include <gpumemory.hpp>
+#include <program.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+/** Where a packed texture lives: which array, which layer, and the part of the layer it covers.*/
+struct TextureSlot {
+    /** Index of the array in `TextureArrayPacker::arrays`, -1 for no texture.*/
+    GLint array = -1;
+    GLint layer = 0;
+    /** Offset(xy) and size(zw) of the image in the layer's UV space.*/
+    glm::vec4 uvRect = glm::vec4(0, 0, 1, 1);
+
+    bool isValid() const { return array >= 0; }
+};
+
+/** Packs many RGBA8 images into a few 2D texture arrays, so draws pick a texture by index instead of binding it.
+
+ Images go into square layers of the next power-of-two size of their larger side. Each size gets its own array(more when there are more images than `GL_MAX_ARRAY_TEXTURE_LAYERS`). An image sits in the corner of its layer, and its edge pixels are repeated over the rest, so filtering and mipmaps never pull in another image or black.
+
+ ```
+ TextureArrayPacker packer;
+ TextureSlot wood = packer.add("wood.png");
+ packer.build();
+ packer.bind(4);                   // arrays on units 4, 5, ... once per frame
+ // GLSL: <packer.glsl()>, then sampleSlot(slot, uvRect, uv)
+ ```
+ `bind` binds every array once; after that, thousands of differently textured draws need no texture binds. `MaterialTable::add(obj, &packer)` puts the slot of each material's `map_Kd` into the material table.
+
+ Images added after `build` are uploaded by the next `build`, which rebuilds only the arrays that changed.
+ */
+struct TextureArrayPacker {
+    struct Array {
+        GLName texture;
+        GLsizei size = 0;
+        GLsizei layers = 0;
+        bool dirty = false;
+    };
+
+    /** Smallest layer size. Tiny images share it instead of getting their own arrays.*/
+    GLsizei minSize = 16;
+    std::vector<Array> arrays;
+
+    /** Load an image file and reserve its slot. The same file returns the same slot.*/
+    TextureSlot add(const std::string &fileName) {
+        auto found = slots.find(fileName);
+        if (found != slots.end()) return found->second;
+
+        int width, height, channels;
+        stbi_set_flip_vertically_on_load(true);
+        unsigned char *data = stbi_load(fileName.c_str(), &width, &height, &channels, 4);
+        if (data == nullptr) {
+            std::cerr << "Texture <" << fileName << "> not found." << std::endl;
+            return TextureSlot();
+        }
+        TextureSlot slot = add(fileName, width, height, data);
+        stbi_image_free(data);
+        return slot;
+    }
+
+    /** Reserve a slot for RGBA8 pixels(rows bottom to top, like GL), e.g. a generated texture.
+
+     The layer is the next power of two of the larger side, square: up to 4x the image's memory, e.g. a 1025x1025 image takes a 2048x2048 layer, and a 1024x256 one a 1024x1024 layer. Resize images to power-of-two squares to avoid it.
+     */
+    TextureSlot add(const std::string &name, const int width, const int height, const unsigned char *rgba) {
+        auto found = slots.find(name);
+        if (found != slots.end()) return found->second;
+        if (width <= 0 || height <= 0) return TextureSlot();
+
+        GLint maxSize = 2048, maxLayers = 256;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+        GLsizei size = minSize;
+        while (size < std::max(width, height)) size *= 2;
+        if (size > maxSize) {
+            std::cerr << "Error on TextureArrayPacker::add: " << name << " is larger than " << maxSize << "." << std::endl;
+            return TextureSlot();
+        }
+
+        // The last array of this size with room left, or a new one.
+        GLint index = -1;
+        for (GLint i = GLint(arrays.size()) - 1; i >= 0; i--)
+            if (arrays[i].size == size) {
+                if (arrays[i].layers < maxLayers) index = i;
+                break;
+            }
+        if (index < 0) {
+            index = GLint(arrays.size());
+            arrays.emplace_back();
+            arrays.back().size = size;
+        }
+
+        Array &array = arrays[index];
+        TextureSlot slot;
+        slot.array = index;
+        slot.layer = array.layers++;
+        slot.uvRect = glm::vec4(0, 0, float(width) / size, float(height) / size);
+        array.dirty = true;
+
+        pending.push_back({index, slot.layer, width, height,
+                           std::vector<unsigned char>(rgba, rgba + size_t(width) * height * 4)});
+        slots[name] = slot;
+        return slot;
+    }
+
+    /** Slot of a texture added before, or an invalid slot.*/
+    TextureSlot find(const std::string &name) const {
+        auto found = slots.find(name);
+        return found == slots.end() ? TextureSlot() : found->second;
+    }
+
+    /** Upload the added images, creating or growing the arrays that changed, and build their mipmaps.
+
+     Growing an array copies its existing layers on the GPU(`glCopyImageSubData`, GL 4.3). Without GL 4.3 it re-uploads them from the images an earlier `build(true)` kept.
+     */
+    void build(const bool keepPixels = false) {
+        for (GLint index = 0; index < GLint(arrays.size()); index++) {
+            Array &array = arrays[index];
+            if (!array.dirty) continue;
+
+            const GLsizei levels = mipLevels(array.size);
+            GLName texture;
+            texture.generate(GPUMemory::Texture);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+            glLabel(GL_TEXTURE, texture, "texture array " + std::to_string(array.size) + "x" + std::to_string(array.size));
+            glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, GL_RGBA8, array.size, array.size, array.layers);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+            // Layers uploaded by an earlier build.
+            const GLsizei oldLayers = array.texture != 0 ? uploadedLayers(index) : 0;
+            if (oldLayers > 0) {
+                if (GLEW_VERSION_4_3) {
+                    glCopyImageSubData(array.texture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+                                       texture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, array.size, array.size, oldLayers);
+                } else {
+                    bool found = false;
+                    for (auto &image : kept)
+                        if (image.array == index) {
+                            upload(array, image);
+                            found = true;
+                        }
+                    if (!found)
+                        std::cerr << "Error on TextureArrayPacker::build: growing an array without GL 4.3 needs build(true) before." << std::endl;
+                }
+            }
+
+            for (auto &image : pending)
+                if (image.array == index) upload(array, image);
+            glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+            array.texture = std::move(texture);
+            array.texture.track(bytes(array), "texture array", "texture array " + std::to_string(array.size));
+            array.dirty = false;
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        glErr("Error on TextureArrayPacker::build()");
+
+        if (keepPixels) kept.insert(kept.end(), pending.begin(), pending.end());
+        for (auto &image : pending) layersUploaded[image.array] = std::max(layersUploaded[image.array], image.layer + 1);
+        pending.clear();
+    }
+
+    /** Bind array i to texture unit `firstUnit + i`.*/
+    void bind(const GLint firstUnit = 0) const {
+        for (size_t i = 0; i < arrays.size(); i++) {
+            glActiveTexture(GLenum(GL_TEXTURE0 + firstUnit + GLint(i)));
+            glBindTexture(GL_TEXTURE_2D_ARRAY, arrays[i].texture);
+        }
+        glActiveTexture(GL_TEXTURE0);
+        YGL_GL_COUNT(textureBinds, arrays.size());
+    }
+
+    /** Point `program`'s `textureArrays` samplers at the units `bind(firstUnit)` uses.*/
+    void attach(const Program &program, const GLint firstUnit = 0) const {
+        glUseProgram(program.programID);
+        for (size_t i = 0; i < arrays.size(); i++) {
+            std::string name = "textureArrays[" + std::to_string(i) + "]";
+            glUniform1i(glGetUniformLocation(program.programID, name.c_str()), firstUnit + GLint(i));
+        }
+        YGL_GL_COUNT(programBinds, 1);
+        YGL_GL_COUNT(uniformUpdates, arrays.size());
+    }
+
+    /** GLSL samplers for the arrays, and `sampleSlot(ivec2(array, layer), uvRect, uv)`, which repeats `uv` inside the slot.
+
+     The mip level comes from the unwrapped `uv`, so it does not jump at the repeats. Filtering does not wrap though: a tiling texture shows its edge pixels stretched, not blended with the opposite edge, along the seam.
+
+     The array index must be the same for a whole draw(e.g. from the material), since GLSL only indexes sampler arrays with dynamically uniform values.
+     */
+    std::string glsl() const {
+        const size_t n = std::max<size_t>(arrays.size(), 1);
+        // Derivatives of the unwrapped uv: those of fract(uv) jump at every repeat, which would pick the smallest mip level there.
+        std::string s = "uniform sampler2DArray textureArrays[" + std::to_string(n) + "];\n"
+                        "vec4 sampleSlot(ivec2 slot, vec4 uvRect, vec2 uv) {\n"
+                        "    vec2 dx = dFdx(uv) * uvRect.zw, dy = dFdy(uv) * uvRect.zw;\n"
+                        "    if (slot.x < 0) return vec4(1.0);\n"
+                        "    vec3 p = vec3(uvRect.xy + fract(uv) * uvRect.zw, float(slot.y));\n"
+                        "    vec4 c = vec4(1.0);\n";
+        // Constant indices work on every driver, dynamically uniform ones not always.
+        for (size_t i = 0; i < n; i++)
+            s += "    " + std::string(i ? "else " : "") + "if (slot.x == " + std::to_string(i) + ") c = textureGrad(textureArrays[" + std::to_string(i) + "], p, dx, dy);\n";
+        s += "    return c;\n}\n";
+        return s;
+    }
+
+    size_t size() const { return slots.size(); }
+
+    void cleanup() {
+        arrays.clear();
+        slots.clear();
+        pending.clear();
+        kept.clear();
+        layersUploaded.clear();
+    }
+
+private:
+    struct Image {
+        GLint array;
+        GLint layer;
+        int width, height;
+        std::vector<unsigned char> rgba;
+    };
+
+    static GLsizei mipLevels(GLsizei size) {
+        GLsizei levels = 1;
+        while (size > 1) {
+            size /= 2;
+            levels++;
+        }
+        return levels;
+    }
+
+    static size_t bytes(const Array &array) {
+        // A full mip chain adds a third.
+        return size_t(array.size) * array.size * 4 * array.layers * 4 / 3;
+    }
+
+    GLsizei uploadedLayers(const GLint index) const {
+        auto found = layersUploaded.find(index);
+        return found == layersUploaded.end() ? 0 : found->second;
+    }
+
+    /** Upload one image into its layer, repeating its last column and row to fill the layer.*/
+    static void upload(const Array &array, const Image &image) {
+        const GLsizei size = array.size;
+        std::vector<unsigned char> layer(size_t(size) * size * 4);
+        for (GLsizei y = 0; y < size; y++) {
+            const unsigned char *row = image.rgba.data() + size_t(std::min(y, image.height - 1)) * image.width * 4;
+            unsigned char *out = layer.data() + size_t(y) * size * 4;
+            std::copy(row, row + size_t(image.width) * 4, out);
+            for (GLsizei x = image.width; x < size; x++) std::copy(row + (image.width - 1) * 4, row + image.width * 4, out + x * 4);
+        }
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, image.layer, size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE, layer.data());
+    }
+
+    std::map<std::string, TextureSlot> slots;
+    std::vector<Image> pending;
+    std::vector<Image> kept;
+    std::map<GLint, GLsizei> layersUploaded;
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** Worker threads shared by the CPU-side mesh passes(`ObjData` normals, bounds, recentering).
+
+ Work is split into chunks that depend only on the item count and grain, never on the number of threads, and `reduce` combines the chunk results in chunk order. Results are therefore the same for any pool size, including 1, which runs everything on the calling thread.
+
+ ```
+ ThreadPool::get().parallelFor(n, [&](size_t begin, size_t end) { for (size_t i = begin; i < end; i++) ...; });
+ float total = ThreadPool::get().reduce(n, 0.f,
+     [&](size_t begin, size_t end) { float s = 0; for (size_t i = begin; i < end; i++) s += x[i]; return s; },
+     [](float a, float b) { return a + b; });
+ ```
+ The calling thread works on the job too. Calls from inside a job, or from another thread while a job runs, run serially instead of waiting, so nesting and concurrent loaders are safe. Bodies must not throw.
+ */
+struct ThreadPool {
+    /** Most chunks a job is split into. Fixed, so chunking does not depend on the pool size.*/
+    static constexpr size_t maxChunks = 256;
+    /** Default smallest chunk, in items. Below it thread handoff costs more than it saves.*/
+    static constexpr size_t defaultGrain = 1 << 14;
+
+    /** The shared pool, with one thread per hardware thread(the caller counts as one).*/
+    static ThreadPool &get() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    /** - parameter threads: Threads working on a job, caller included; 0 for one per hardware thread.*/
+    explicit ThreadPool(const size_t threads = 0) { resize(threads); }
+
+    ~ThreadPool() { stop(); }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /** Change the thread count, e.g. to 1 to run everything serially. Not while a job runs.*/
+    void resize(size_t threads) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        stop();
+        stopping = false;
+        for (size_t i = 1; i < threads; i++) workers.emplace_back([this] { workerLoop(); });
+    }
+
+    /** Threads working on a job, caller included.*/
+    size_t size() const { return workers.size() + 1; }
+
+    /** Call `body(begin, end)` on disjoint ranges covering [0, n), in parallel.*/
+    template <typename Body>
+    void parallelFor(const size_t n, Body body, const size_t grain = defaultGrain) {
+        if (n == 0) return;
+        const size_t chunk = chunkSize(n, grain);
+        run((n + chunk - 1) / chunk, [&](const size_t i) { body(i * chunk, std::min(n, (i + 1) * chunk)); });
+    }
+
+    /** `combine` the `map(begin, end)` results of the chunks of [0, n), left to right starting from `identity`.
+
+     The order of combining is fixed, so non-associative operations like float sums give the same result every run.
+     */
+    template <typename T, typename Map, typename Combine>
+    T reduce(const size_t n, const T &identity, Map map, Combine combine, const size_t grain = defaultGrain) {
+        if (n == 0) return identity;
+        const size_t chunk = chunkSize(n, grain);
+        std::vector<T> partial((n + chunk - 1) / chunk, identity);
+        run(partial.size(), [&](const size_t i) { partial[i] = map(i * chunk, std::min(n, (i + 1) * chunk)); });
+        T result = identity;
+        for (const T &p : partial) result = combine(result, p);
+        return result;
+    }
+
+private:
+    static size_t chunkSize(const size_t n, const size_t grain) {
+        return std::max(std::max<size_t>(grain, 1), (n + maxChunks - 1) / maxChunks);
+    }
+
+    static bool &insideJob() {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    /** Run `task(i)` for every chunk i in [0, chunks).*/
+    void run(const size_t chunks, const std::function<void(size_t)> &task) {
+        std::unique_lock<std::mutex> submit(submitMutex, std::try_to_lock);
+        if (chunks == 1 || workers.empty() || insideJob() || !submit.owns_lock()) {
+            for (size_t i = 0; i < chunks; i++) task(i);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &task;
+            jobChunks = chunks;
+            next = 0;
+            remaining = chunks;
+            generation++;
+        }
+        wake.notify_all();
+        work(task, chunks);
+
+        // Workers that picked up the job may still be looking for chunks; `job` must outlive them.
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return remaining == 0 && active == 0; });
+        job = nullptr;
+    }
+
+    void work(const std::function<void(size_t)> &task, const size_t chunks) {
+        insideJob() = true;
+        for (size_t i = next++; i < chunks; i = next++) {
+            task(i);
+            if (--remaining == 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.notify_all();
+            }
+        }
+        insideJob() = false;
+    }
+
+    void workerLoop() {
+        size_t seen = 0;
+        for (;;) {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+            if (job == nullptr) continue;
+            const std::function<void(size_t)> *task = job;
+            const size_t chunks = jobChunks;
+            active++;
+            lock.unlock();
+
+            work(*task, chunks);
+
+            lock.lock();
+            if (--active == 0) finished.notify_all();
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &t : workers) t.join();
+        workers.clear();
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex submitMutex;
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    bool stopping = false;
+    size_t generation = 0;
+    size_t active = 0;
+
+    const std::function<void(size_t)> *job = nullptr;
+    size_t jobChunks = 0;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> remaining{0};
+};
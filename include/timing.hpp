@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace timing {
+using Clock = std::chrono::steady_clock;
+
+inline double seconds(const Clock::duration &d) {
+    return std::chrono::duration<double>(d).count();
+}
+inline double milliseconds(const Clock::duration &d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+/** Wait until `deadline`.
+
+ OS sleep overshoots by up to a scheduler tick, so sleep until `spinSeconds` before the deadline and busy-wait the rest.
+ */
+inline void sleepUntil(const Clock::time_point &deadline, const double spinSeconds = 0.002) {
+    auto spinStart = deadline - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(spinSeconds));
+    if (Clock::now() < spinStart)
+        std::this_thread::sleep_until(spinStart);
+    while (Clock::now() < deadline)
+        std::this_thread::yield();
+}
+}
+
+/** Summary of recorded frame times in milliseconds.*/
+struct FrameStats {
+    int count = 0;
+    double mean = 0;
+    double min = 0;
+    double p50 = 0;
+    double p90 = 0;
+    double p99 = 0;
+    double max = 0;
+};
+
+/** Ring buffer of the latest frame times in milliseconds.*/
+struct FrameTimeHistory {
+    FrameTimeHistory(const size_t capacity = 1024) : capacity(capacity) {
+        times.reserve(capacity);
+    }
+
+    void push(const double ms) {
+        if (times.size() < capacity) times.push_back(ms);
+        else times[next] = ms;
+        next = (next + 1) % capacity;
+    }
+
+    void clear() {
+        times.clear();
+        next = 0;
+    }
+
+    FrameStats stats() const {
+        FrameStats s;
+        if (times.empty()) return s;
+
+        std::vector<double> sorted(times);
+        std::sort(sorted.begin(), sorted.end());
+
+        auto percentile = [&](const double p) {
+            return sorted[std::min(sorted.size() - 1, size_t(p * (sorted.size() - 1) + 0.5))];
+        };
+
+        double sum = 0;
+        for (auto t : sorted) sum += t;
+
+        s.count = int(sorted.size());
+        s.mean = sum / sorted.size();
+        s.min = sorted.front();
+        s.p50 = percentile(0.5);
+        s.p90 = percentile(0.9);
+        s.p99 = percentile(0.99);
+        s.max = sorted.back();
+        return s;
+    }
+
+    size_t capacity;
+    std::vector<double> times;
+
+private:
+    size_t next = 0;
+};